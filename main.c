@@ -10,27 +10,105 @@
 #include <errno.h>
 #include <sys/types.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <netinet/in.h>
 #include <arpa/inet.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdarg.h>
+#include <sys/uio.h>
+#include <sys/wait.h>
+#include <spawn.h>
+#include <poll.h>
+#include <pthread.h>
+#include <strings.h>
+#include <dirent.h>
+extern char **environ;
+#ifdef __linux__
+#include <sys/timerfd.h>
+#include <sys/inotify.h>
+#include <sys/epoll.h>
+#endif
 
-// ---------- Data model & linked list ----------
+// ---------- Data model & task arena ----------
 
 typedef struct {
     int id;
-    time_t due;
-    char description[256];
+    uint32_t len;       // description length in bytes
+    time_t due;         // for a recurring task, its first occurrence
+    uint32_t desc;      // offset of the description in `strs`
+    uint32_t repeat;    // recurrence rule (REPEAT_*), 0 = one-off
 } Task;
 
-typedef struct Node {
-    Task task;
-    struct Node *next;
-} Node;
+// Descriptions of the current list (active, removed and any archived
+// tasks read in) live back to back, NUL-terminated, in one string arena;
+// offset 0 is the empty string. With CLITASK_INTERN (default on) a
+// description already in the arena is shared instead of copied again.
+// Loads copy descriptions in with str_load and the intern table is built
+// on first use, so a load that never adds tasks never hashes; repeats
+// among loaded descriptions are shared from the next compaction on.
+// Offsets are 32-bit: at most 4 GiB of text per list.
+typedef struct {
+    char     *data;
+    size_t    len, cap;
+    uint32_t *slots;     // intern table: offset per bucket, 0 = empty
+    size_t    slot_cap, nslots;
+    size_t    indexed;   // bytes of data already entered in the table
+    size_t    kept;      // len after the last compaction
+} StrArena;
+
+typedef struct OrderIndex OrderIndex;
+
+// Tasks live in one contiguous arena in insertion order. Removal leaves a
+// hole (id 0) that iteration skips, and holes are squeezed out once they
+// outnumber live records. An open-addressing index maps id -> slot so
+// lookup and removal are O(1); `order` keeps the slots of one-off tasks
+// sorted by due, and `rules` lists the recurring ones.
+typedef struct {
+    Task    *recs;
+    size_t   len;        // slots in use, holes included
+    size_t   cap;
+    size_t   live;
+    int32_t *index;      // slot per bucket, -1 = empty; power-of-two size
+    size_t   index_cap;
+    void    *map;        // set while recs points into an mmapped store
+    size_t   map_len;
+    OrderIndex *order;   // built on first ordered read, NULL until then
+    int32_t *rules;      // ids of recurring tasks
+    size_t   nrules, rules_cap;
+} TaskList;
+
+// Occurrences of recurring tasks deleted one at a time, as (id, due)
+// pairs sorted for lookup. Rules are few and so are their exceptions.
+typedef struct {
+    int32_t id;
+    int64_t due;
+} Skip;
+
+typedef struct {
+    Skip  *v;
+    size_t n, cap;
+} SkipSet;
 
-static Node *head = NULL;      
-static Node *trash_head = NULL;
+static TaskList tasks;
+static TaskList trash;
+static StrArena strs;
+static SkipSet skips;
 static int nextId = 1;
 static char active_file[512] = "tasks.txt";
 static char removed_file[512] = "removed.txt";
+static char journal_file[520] = "tasks.txt.journal";
+static char index_file[520] = "tasks.txt.idx";
+static char archive_file[530] = "removed.txt.segments";
+static char lock_file[520] = "tasks.txt.lock";
+static char lists_dir[256] = "lists";
+static bool store_binary = false;
+static off_t journal_applied = 0;   // journal bytes reflected in memory
+static bool store_bad = false;      // a store file exists but did not load
+static unsigned long store_generation = 1;  // bumped whenever tasks change
 
 static bool use_ansi(void) {
     const char *u = getenv("USE_COLOR");
@@ -61,12 +139,43 @@ static size_t env_limit(const char *name, size_t def){
     return (size_t)v;
 }
 
+static double mono_seconds(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec/1e9;
+}
+
+static void report_throughput(const char *verb, size_t n, double secs){
+    printf("%s %zu task%s in %.3fs", verb, n, n==1 ? "" : "s", secs);
+    if (secs > 0 && n) printf(" (%.0f tasks/s)", (double)n/secs);
+    printf(".\n");
+}
+
+// strncpy that always terminates.
+static void copy_bounded(char *dst, size_t L, const char *src){
+    size_t n=strlen(src);
+    if (n >= L) n = L-1;
+    memcpy(dst,src,n);
+    dst[n]='\0';
+}
+
+static uint64_t fnv1a(const char *p, size_t n){
+    uint64_t h=1469598103934665603ull;
+    for (size_t i=0;i<n;i++) { h^=(unsigned char)p[i]; h*=1099511628211ull; }
+    return h;
+}
+
 static char *lcase(char *s) {
     for (char *p=s; *p; ++p) *p=(char)tolower((unsigned char)*p);
     return s;
 }
 
+// Also called to switch back to the default list, so every path is set.
 static void init_paths(void) {
+    const char *st = getenv("CLITASK_STORE");
+    store_binary = st && strcmp(st, "binary") == 0;
+    strcpy(active_file, store_binary ? "tasks.bin" : "tasks.txt");
+    strcpy(removed_file, store_binary ? "removed.bin" : "removed.txt");
     const char *a = getenv("CLITASK_FILE");
     const char *r = getenv("CLITASK_REMOVED");
     if (a && *a) {
@@ -77,6 +186,39 @@ static void init_paths(void) {
         strncpy(removed_file, r, sizeof removed_file - 1);
         removed_file[sizeof removed_file - 1] = '\0';
     }
+    const char *j = getenv("CLITASK_JOURNAL");
+    if (j && *j) {
+        strncpy(journal_file, j, sizeof journal_file - 1);
+        journal_file[sizeof journal_file - 1] = '\0';
+    } else {
+        snprintf(journal_file, sizeof journal_file, "%s.journal", active_file);
+    }
+    snprintf(archive_file, sizeof archive_file, "%s.segments", removed_file);
+    snprintf(lock_file, sizeof lock_file, "%s.lock", active_file);
+    const char *x = getenv("CLITASK_INDEX");
+    if (x && *x) copy_bounded(index_file, sizeof index_file, x);
+    else snprintf(index_file, sizeof index_file, "%s.idx", active_file);
+    const char *d = getenv("CLITASK_LISTS");
+    if (d && *d) copy_bounded(lists_dir, sizeof lists_dir, d);
+}
+
+// A named list keeps the usual files in <lists dir>/<name>/.
+static bool list_name_ok(const char *name, size_t n){
+    if (n==0 || n>64 || name[0]=='.') return false;
+    for (size_t i=0;i<n;i++)
+        if (!isalnum((unsigned char)name[i]) && !strchr("._-",name[i])) return false;
+    return true;
+}
+
+static void set_list_paths(const char *name){
+    const char *a = store_binary ? "tasks.bin" : "tasks.txt";
+    const char *r = store_binary ? "removed.bin" : "removed.txt";
+    snprintf(active_file, sizeof active_file, "%s/%s/%s", lists_dir, name, a);
+    snprintf(removed_file, sizeof removed_file, "%s/%s/%s", lists_dir, name, r);
+    snprintf(journal_file, sizeof journal_file, "%s.journal", active_file);
+    snprintf(archive_file, sizeof archive_file, "%s.segments", removed_file);
+    snprintf(lock_file, sizeof lock_file, "%s.lock", active_file);
+    snprintf(index_file, sizeof index_file, "%s.idx", active_file);
 }
 
 // ---------- Date & time parsing ----------
@@ -140,14 +282,16 @@ static void today_YMD(int *Y,int *M,int *D,int *w){
     if(w)*w=tm.tm_wday;
 }
 
-static bool same_ymd(time_t a, time_t b){
-    if(!a||!b) return false;
-    struct tm ta,tb;
-    localtime_r(&a,&ta);
-    localtime_r(&b,&tb);
-    return ta.tm_year==tb.tm_year &&
-           ta.tm_mon==tb.tm_mon &&
-           ta.tm_mday==tb.tm_mday;
+// Local midnight of the day containing t, moved by `days` days.
+static time_t local_midnight(time_t t, int days){
+    struct tm tm;
+    localtime_r(&t,&tm);
+    tm.tm_hour=0;
+    tm.tm_min=0;
+    tm.tm_sec=0;
+    tm.tm_mday+=days;
+    tm.tm_isdst=-1;
+    return mktime(&tm);
 }
 
 static void fmt_when(time_t t, char *out, size_t L) {
@@ -160,6 +304,35 @@ static void fmt_when(time_t t, char *out, size_t L) {
     strftime(out,L,"%Y-%m-%d %H:%M",&tm);
 }
 
+// fmt_when for runs of rows: remembers the "YYYY-MM-DD " prefix of the
+// last local day seen and derives HH:MM from the offset into it, so rows
+// sorted by due date mostly skip localtime_r/strftime. Days with a DST
+// change take the slow path.
+typedef struct {
+    time_t start;
+    time_t end;
+    char   prefix[16];
+} DayFmt;
+
+static void fmt_when_day(DayFmt *d, time_t t, char *out, size_t L){
+    if (!t || !d || L < 17) { fmt_when(t,out,L); return; }
+    if (!d->end || t < d->start || t >= d->end) {
+        d->start=local_midnight(t,0);
+        d->end=local_midnight(t,1);
+        struct tm tm;
+        localtime_r(&t,&tm);
+        strftime(d->prefix,sizeof d->prefix,"%Y-%m-%d ",&tm);
+    }
+    if (d->end - d->start != 86400) { fmt_when(t,out,L); return; }
+    long secs=(long)(t - d->start);
+    long h=secs/3600, m=(secs/60)%60;
+    memcpy(out,d->prefix,11);
+    out[11]=(char)('0'+h/10); out[12]=(char)('0'+h%10);
+    out[13]=':';
+    out[14]=(char)('0'+m/10); out[15]=(char)('0'+m%10);
+    out[16]='\0';
+}
+
 static time_t parse_due(const char *date_tok, const char *time_tok) {
     int Y,M,D,w;
     today_YMD(&Y,&M,&D,&w);
@@ -195,537 +368,6275 @@ static time_t parse_due(const char *date_tok, const char *time_tok) {
     return make_time_local(Y,outM,outD,hh,mm);
 }
 
-static void list_push_head(Node **h, Task t){
-    Node *n=(Node*)malloc(sizeof *n);
-    if(!n){perror("malloc"); exit(1);}
-    n->task=t;
-    n->next=*h;
-    *h=n;
+// A point in time given on the command line or in a query string: epoch
+// seconds, or a parse_due date token (today, tomorrow, MM/DD).
+static time_t parse_time_arg(const char *v){
+    char *end=NULL;
+    long long n=strtoll(v,&end,10);
+    if (*v && *end=='\0') return (time_t)n;
+    return parse_due(v,NULL);
 }
 
-static bool list_remove_by_id(Node **h,int id, Task *out){
-    Node *cur=*h,*prev=NULL;
-    while(cur){
-        if(cur->task.id==id){
-            if(prev)prev->next=cur->next;
-            else *h=cur->next;
-            if(out)*out=cur->task;
-            free(cur);
-            return true;
-        }
-        prev=cur;
-        cur=cur->next;
+// Splits "[date] [time]" as `add` takes it ("tomorrow 9am", "10/20",
+// "14:00") into parse_due's two tokens; a lone time goes to tm (today).
+static void split_due(const char *s, char *date, char *tm, size_t L){
+    char a[32]="", b[32]="";
+    if (sscanf(s,"%31s %31s",a,b) < 1) return;
+    int h=0, m=0;
+    if (!b[0] && !parse_mmdd(a,&h,&m) && parse_time_token(a,&h,&m)) {
+        copy_bounded(tm,L,a);
+        return;
     }
-    return false;
+    copy_bounded(date,L,a);
+    copy_bounded(tm,L,b);
 }
 
-static size_t list_count(Node *h){
-    size_t c=0;
-    for(;h;h=h->next) c++;
-    return c;
-}
+// Recurring tasks are one rule each: due is the first occurrence and
+// `repeat` how the others follow. Days, weeks and months step in local
+// time, so a 09:00 standup stays at 09:00 across DST changes, and a
+// monthly task on the 31st falls on the last day of shorter months.
+// Rules are written as daily, weekdays, weekly, monthly, hourly or <N>h
+// (every N hours), on the command line and in the stores alike.
 
-static void list_free(Node **h){
-    Node *c=*h;
-    while(c){Node *n=c; c=c->next; free(n);}
-    *h=NULL;
-}
+enum { REPEAT_NONE, REPEAT_DAILY, REPEAT_WEEKDAYS, REPEAT_WEEKLY,
+       REPEAT_MONTHLY, REPEAT_HOURS };
 
-// ---------- Persistence & storage ----------
+#define REPEAT_KIND(r)       ((r) & 0xfu)
+#define REPEAT_EVERY(r)      ((r) >> 4)
+#define REPEAT_RULE(kind, n) ((uint32_t)(kind) | (uint32_t)(n) << 4)
+#define REPEAT_MAX_HOURS     8784
 
-static bool load_file(const char *path, Node **out_head, int *io_nextId) {
-    *out_head = NULL;
-    Node *tail=NULL;
-    FILE *f=fopen(path,"r");
-    if(!f) return true;
-    char line[1024];
-    while (fgets(line,sizeof line,f)) {
-        int id=0;
-        long long due=0;
-        char desc[256]={0};
-        int n = sscanf(line,"%d %lld %255[^\n]", &id,&due,desc);
-        if (n < 3) continue;
-        Task t={0};
-        t.id=id;
-        t.due=(time_t)due;
-        strncpy(t.description,desc,sizeof t.description - 1);
-        Node *node=(Node*)malloc(sizeof *node);
-        if(!node){perror("malloc"); fclose(f); exit(1);}
-        node->task=t;
-        node->next=NULL;
-        if(!*out_head) {
-            *out_head=node; tail=node;
-        } else {
-            tail->next=node; tail=node;
-        }
-        if (io_nextId && id >= *io_nextId) *io_nextId = id + 1;
-    }
-    fclose(f);
-    return true;
+static const char *const repeat_names[]={NULL,"daily","weekdays","weekly","monthly"};
+
+static bool repeat_ok(uint32_t r){
+    unsigned k=REPEAT_KIND(r), n=REPEAT_EVERY(r);
+    if (k==REPEAT_HOURS) return n>=1 && n<=REPEAT_MAX_HOURS;
+    return k>=REPEAT_DAILY && k<=REPEAT_MONTHLY && n==1;
 }
 
-static bool save_file(const char *path, Node *h, bool verbose){
-    FILE *f=fopen(path,"w");
-    if(!f){perror("open for write"); return false;}
-    for(Node *n=h;n;n=n->next){
-        fprintf(f,"%d %lld %s\n", n->task.id,
-                (long long)n->task.due, n->task.description);
-    }
-    fclose(f);
-    if(verbose) printf("Saved %s\n", path);
+static bool token_is(const char *tok, size_t n, const char *word){
+    if (strlen(word) != n) return false;
+    for (size_t i=0;i<n;i++)
+        if (tolower((unsigned char)tok[i]) != word[i]) return false;
     return true;
 }
 
-static void save_all_quiet(void){
-    save_file(active_file, head, false);
-    save_file(removed_file, trash_head, false);
+// One rule token of n bytes.
+static bool parse_repeat(const char *tok, size_t n, uint32_t *out){
+    for (unsigned k=REPEAT_DAILY;k<=REPEAT_MONTHLY;k++)
+        if (token_is(tok,n,repeat_names[k])) { *out=REPEAT_RULE(k,1); return true; }
+    if (token_is(tok,n,"hourly")) { *out=REPEAT_RULE(REPEAT_HOURS,1); return true; }
+    unsigned every=0;
+    size_t i=0;
+    while (i<n && tok[i]>='0' && tok[i]<='9' && every<=REPEAT_MAX_HOURS)
+        every=every*10 + (unsigned)(tok[i++]-'0');
+    if (i==0 || i+1!=n || tolower((unsigned char)tok[i])!='h') return false;
+    *out=REPEAT_RULE(REPEAT_HOURS,every);
+    return repeat_ok(*out);
 }
 
-static void save_all_verbose(void){
-    save_file(active_file, head, true);
-    save_file(removed_file, trash_head, true);
+static void repeat_name(uint32_t r, char *out, size_t L){
+    if (REPEAT_KIND(r)==REPEAT_HOURS) {
+        if (REPEAT_EVERY(r)==1) snprintf(out,L,"hourly");
+        else snprintf(out,L,"%uh",(unsigned)REPEAT_EVERY(r));
+    } else {
+        snprintf(out,L,"%s",repeat_names[REPEAT_KIND(r)]);
+    }
 }
 
-static void reload_all_from_disk(void){
-    list_free(&head);
-    list_free(&trash_head);
-    nextId = 1;
-    load_file(active_file, &head, &nextId);
-    load_file(removed_file, &trash_head, &nextId);
+static int days_in_month(int year, int mon){
+    static const int dim[12]={31,28,31,30,31,30,31,31,30,31,30,31};
+    if (mon==1 && ((year%4==0 && year%100!=0) || year%400==0)) return 29;
+    return dim[mon];
 }
 
-static void print_welcome_header(void){
-    const char *B=S_BOLD(), *R=S_RESET(), *BL=C_BLUE();
-    printf("%s%s========================================%s\n", BL,B,R);
-    printf("%s TODO LIST%s\n", B,R);
-    printf("%s========================================%s\n", BL,B?R:"");
-    time_t now=time(NULL);
-    char buf[64];
+// The k-th step (k >= 0) from the first occurrence, weekends included.
+static time_t repeat_step(const Task *t, long k){
+    if (REPEAT_KIND(t->repeat)==REPEAT_HOURS)
+        return t->due + (time_t)k * REPEAT_EVERY(t->repeat) * 3600;
     struct tm tm;
-    localtime_r(&now,&tm);
-    strftime(buf,sizeof buf,"%A, %Y-%m-%d %H:%M",&tm);
-    printf("Now: %s\n", buf);
-    printf("Active: %s\n", active_file);
-    printf("Removed: %s\n\n", removed_file);
+    localtime_r(&t->due,&tm);
+    switch (REPEAT_KIND(t->repeat)) {
+    case REPEAT_WEEKLY: tm.tm_mday += (int)(7*k); break;
+    case REPEAT_MONTHLY: {
+        long mon=tm.tm_mon + k;
+        int mday=tm.tm_mday;
+        tm.tm_year += (int)(mon/12);
+        tm.tm_mon = (int)(mon%12);
+        int last=days_in_month(tm.tm_year+1900, tm.tm_mon);
+        tm.tm_mday = mday < last ? mday : last;
+        break;
+    }
+    default: tm.tm_mday += (int)k;
+    }
+    tm.tm_isdst=-1;
+    return mktime(&tm);
 }
 
-static bool is_today_local(time_t t){
-    if(!t) return false;
-    time_t now=time(NULL);
-    return same_ymd(t, now);
+static size_t skip_lower(int id, time_t due){
+    size_t lo=0, hi=skips.n;
+    while (lo < hi) {
+        size_t mid=lo+(hi-lo)/2;
+        const Skip *k=&skips.v[mid];
+        if (k->id < id || (k->id==id && k->due < (int64_t)due)) lo=mid+1;
+        else hi=mid;
+    }
+    return lo;
 }
 
-static bool is_tomorrow_local(time_t t){
-    if (!t) return false;
-    time_t now=time(NULL);
-    struct tm tm;
-    localtime_r(&now,&tm);
-    tm.tm_mday += 1;
-    time_t tom = mktime(&tm);
-    return same_ymd(t, tom);
+static bool skip_has(int id, time_t due){
+    if (!skips.n) return false;
+    size_t i=skip_lower(id,due);
+    return i<skips.n && skips.v[i].id==id && skips.v[i].due==(int64_t)due;
 }
 
-static int cmp_task_ptrs(const void *a,const void *b){
-    const Node *na=*(const Node * const *)a, *nb=*(const Node * const *)b;
-    if (na->task.due==0 && nb->task.due==0) return na->task.id - nb->task.id;
-    if (na->task.due==0) return 1;
-    if (nb->task.due==0) return -1;
-    if (na->task.due < nb->task.due) return -1;
-    if (na->task.due > nb->task.due) return 1;
-    return na->task.id - nb->task.id;
+static void skip_add(int id, time_t due){
+    size_t i=skip_lower(id,due);
+    if (i<skips.n && skips.v[i].id==id && skips.v[i].due==(int64_t)due) return;
+    if (skips.n==skips.cap) {
+        skips.cap = skips.cap ? skips.cap*2 : 16;
+        Skip *v=(Skip*)realloc(skips.v, skips.cap * sizeof *v);
+        if(!v){perror("realloc"); exit(1);}
+        skips.v=v;
+    }
+    memmove(skips.v+i+1, skips.v+i, (skips.n-i) * sizeof *skips.v);
+    skips.v[i].id=id;
+    skips.v[i].due=(int64_t)due;
+    skips.n++;
 }
 
-static void print_task_row(const Task *t){
-    char when[32];
-    fmt_when(t->due, when, sizeof when);
-    printf("%-16s %-3d %s\n", when, t->id, t->description);
+// First occurrence of rule t at or after `from` that was not deleted.
+static time_t repeat_next(const Task *t, time_t from){
+    static const long approx[]={0,86400,86400,7*86400,2629746,3600};
+    long period=approx[REPEAT_KIND(t->repeat)];
+    if (REPEAT_KIND(t->repeat)==REPEAT_HOURS) period*=(long)REPEAT_EVERY(t->repeat);
+    long k = from > t->due ? (long)((from - t->due) / period) - 1 : 0;
+    if (k < 0) k=0;
+    time_t at=repeat_step(t,k);
+    for (;;) {
+        while (at < from) at=repeat_step(t,++k);
+        if (REPEAT_KIND(t->repeat)==REPEAT_WEEKDAYS) {
+            struct tm tm;
+            localtime_r(&at,&tm);
+            if (tm.tm_wday==0 || tm.tm_wday==6) { at=repeat_step(t,++k); continue; }
+        }
+        if (!skip_has(t->id,at)) return at;
+        at=repeat_step(t,++k);
+    }
 }
 
-static Node **collect_sorted(Node *h, size_t *out_n){
-    size_t n=list_count(h);
-    Node **arr=(Node**)malloc(n ? n * sizeof *arr : sizeof *arr);
-    if (!arr) { perror("malloc"); exit(1); }
-    size_t i=0;
-    for(Node *c=h;c;c=c->next) arr[i++]=c;
-    qsort(arr,n,sizeof(Node*),cmp_task_ptrs);
-    *out_n = n;
-    return arr;
+// Ordered index: a B+tree over (due, id) with undated tasks last, the
+// order cmp_task_ptrs gives. It is built the first time something reads a
+// list in order and then kept up by tl_push/tl_remove, so ordered reads
+// cost O(log N + K). Deletes never merge nodes; leaves may run empty, and
+// once the tree is less than a quarter full it is rebuilt from its own
+// leaf chain, the same amortised squeeze the arena does for holes.
+
+#define ORD_FAN 64
+
+typedef struct {
+    int64_t  due;            // undated = INT64_MAX
+    int32_t  id;
+    uint32_t slot;
+} OrdEntry;
+
+typedef struct OrdLeaf {
+    struct OrdLeaf *next;
+    int      n;
+    OrdEntry e[ORD_FAN];
+} OrdLeaf;
+
+typedef struct {
+    int      n;              // children
+    OrdEntry key[ORD_FAN];   // key[i] <= everything under child[i], i > 0
+    void    *child[ORD_FAN];
+} OrdInner;
+
+struct OrderIndex {
+    void    *root;
+    int      height;         // inner levels above the leaves
+    OrdLeaf *first;
+    size_t   count;
+    size_t   leaves;
+};
+
+typedef struct {
+    OrdLeaf *leaf;
+    int      pos;
+} OrdIter;
+
+static int64_t ord_key(time_t due){
+    return due ? (int64_t)due : INT64_MAX;
 }
 
-// ---------- Commands, HTTP server & watcher ----------
+static int ord_cmp(const OrdEntry *a, const OrdEntry *b){
+    if (a->due != b->due) return a->due < b->due ? -1 : 1;
+    return (a->id > b->id) - (a->id < b->id);
+}
 
-static void cmd_help(int argc, char **argv){
-    (void)argc; (void)argv;
-    print_welcome_header();
-    printf("Commands:\n");
-    printf(" add \"desc\" [date] [time]\n");
-    printf(" list\n");
-    printf(" delete <id>\n");
-    printf(" removed\n");
-    printf(" save\n");
-    printf(" help\n");
-    printf(" serve <port> # view tasks via HTTP at /\n");
-    printf(" watch [interval] [lead_min] [notify-cmd ...]\n");
-    printf("\n");
+// First position in e[0..n) not below k.
+static int ord_lower(const OrdEntry *e, int n, const OrdEntry *k){
+    int lo=0, hi=n;
+    while (lo<hi) {
+        int mid=(lo+hi)/2;
+        if (ord_cmp(&e[mid],k) < 0) lo=mid+1;
+        else hi=mid;
+    }
+    return lo;
 }
 
-static void cmd_add(int argc, char **argv){
-    if (argc < 1) {
-        printf("Usage: add \"desc\" [date] [time]\n");
-        return;
+// Child of an inner node that holds k.
+static int ord_route(const OrdInner *in, const OrdEntry *k){
+    int lo=1, hi=in->n;
+    while (lo<hi) {
+        int mid=(lo+hi)/2;
+        if (ord_cmp(&in->key[mid],k) <= 0) lo=mid+1;
+        else hi=mid;
     }
-    const char *desc_in = argv[0];
-    const char *date_tok = (argc>=2)? argv[1] : NULL;
-    const char *time_tok = (argc>=3)? argv[2] : NULL;
-    char desc[256];
-    strncpy(desc, desc_in, sizeof desc - 1);
-    desc[sizeof desc - 1]='\0';
-    time_t due = parse_due(date_tok, time_tok);
-    Task t={0};
-    t.id=nextId++;
-    t.due=due;
-    strncpy(t.description, desc, sizeof t.description - 1);
-    list_push_head(&head, t);
-    char when[32];
-    fmt_when(t.due, when, sizeof when);
-    printf("%sAdded%s #%d: %s (due: %s)\n",
-           C_BLUE(), S_RESET(), t.id, t.description, when);
-    save_all_quiet();
+    return lo-1;
 }
 
-static void cmd_list(int argc, char **argv){
-    (void)argc; (void)argv;
-    print_welcome_header();
-    size_t n=list_count(head);
-    if (n==0) {
-        printf("No tasks.\n");
-        return;
+static void *ord_alloc(size_t n){
+    void *p=malloc(n);
+    if(!p){perror("malloc"); exit(1);}
+    return p;
+}
+
+static void ord_free_node(void *node, int h){
+    if (h) {
+        OrdInner *in=(OrdInner*)node;
+        for (int i=0;i<in->n;i++) ord_free_node(in->child[i],h-1);
     }
-    Node **arr=collect_sorted(head, &n);
+    free(node);
+}
 
-    printf("%sToday's Tasks%s\n", C_BLUE(), S_RESET());
-    printf("Due              ID  Description\n");
-    printf("---------------- --- ------------------------------\n");
-    size_t printed_today=0;
-    for (size_t i=0;i<n;i++) {
-        const Task *t = &arr[i]->task;
-        if (t->due && is_today_local(t->due)) {
-            print_task_row(t);
-            printed_today++;
+static void ord_free(OrderIndex *o){
+    if (!o) return;
+    if (o->root) ord_free_node(o->root,o->height);
+    free(o);
+}
+
+// Builds the tree over sorted entries, leaves packed full.
+static OrderIndex *ord_build(const OrdEntry *e, size_t n){
+    OrderIndex *o=(OrderIndex*)ord_alloc(sizeof *o);
+    memset(o,0,sizeof *o);
+    size_t nodes=(n + ORD_FAN-1)/ORD_FAN;
+    if (!nodes) nodes=1;
+    void **level=(void**)ord_alloc(nodes * sizeof *level);
+    OrdEntry *first=(OrdEntry*)ord_alloc(nodes * sizeof *first);
+    OrdLeaf *prev=NULL;
+    for (size_t i=0;i<nodes;i++) {
+        OrdLeaf *lf=(OrdLeaf*)ord_alloc(sizeof *lf);
+        size_t from=i*ORD_FAN, cnt = n-from < ORD_FAN ? n-from : ORD_FAN;
+        if (from > n) cnt=0;
+        lf->n=(int)cnt;
+        lf->next=NULL;
+        memcpy(lf->e, e+from, cnt * sizeof *e);
+        if (cnt) first[i]=e[from];
+        if (prev) prev->next=lf;
+        else o->first=lf;
+        prev=lf;
+        level[i]=lf;
+    }
+    o->leaves=nodes;
+    while (nodes > 1) {
+        size_t up=(nodes + ORD_FAN-1)/ORD_FAN;
+        for (size_t i=0;i<up;i++) {
+            OrdInner *in=(OrdInner*)ord_alloc(sizeof *in);
+            size_t from=i*ORD_FAN, cnt = nodes-from < ORD_FAN ? nodes-from : ORD_FAN;
+            in->n=(int)cnt;
+            for (size_t k=0;k<cnt;k++) {
+                in->child[k]=level[from+k];
+                in->key[k]=first[from+k];
+            }
+            first[i]=first[from];
+            level[i]=in;
         }
+        nodes=up;
+        o->height++;
     }
-    if (!printed_today) printf(" (none)\n");
-    printf("\n");
+    o->root=level[0];
+    o->count=n;
+    free(level);
+    free(first);
+    return o;
+}
 
-    printf("%sTomorrow's Tasks%s\n", C_BLACK(), S_RESET());
-    printf("Due              ID  Description\n");
-    printf("---------------- --- ------------------------------\n");
-    size_t printed_tom=0;
-    for (size_t i=0;i<n;i++) {
-        const Task *t = &arr[i]->task;
-        if (t->due && is_tomorrow_local(t->due)) {
-            print_task_row(t);
-            printed_tom++;
+// Inserts into the subtree; returns a new right sibling (and its first
+// key in *sep) when the node had to split.
+static void *ord_insert_at(OrderIndex *o, void *node, int h, const OrdEntry *e, OrdEntry *sep){
+    if (h==0) {
+        OrdLeaf *lf=(OrdLeaf*)node;
+        int pos=ord_lower(lf->e,lf->n,e);
+        if (lf->n < ORD_FAN) {
+            memmove(&lf->e[pos+1], &lf->e[pos], (size_t)(lf->n-pos) * sizeof *e);
+            lf->e[pos]=*e;
+            lf->n++;
+            return NULL;
         }
+        // Appending past the last leaf (new ids, undated tasks) starts a
+        // fresh leaf instead of leaving two half-full ones.
+        int keep = (pos==ORD_FAN && !lf->next) ? ORD_FAN : ORD_FAN/2;
+        OrdLeaf *r=(OrdLeaf*)ord_alloc(sizeof *r);
+        r->n=ORD_FAN-keep;
+        memcpy(r->e, &lf->e[keep], (size_t)r->n * sizeof *e);
+        lf->n=keep;
+        r->next=lf->next;
+        lf->next=r;
+        o->leaves++;
+        OrdLeaf *dst = pos <= keep && keep < ORD_FAN ? lf : r;
+        if (dst==r) pos-=keep;
+        memmove(&dst->e[pos+1], &dst->e[pos], (size_t)(dst->n-pos) * sizeof *e);
+        dst->e[pos]=*e;
+        dst->n++;
+        *sep=r->e[0];
+        return r;
     }
-    if (!printed_tom) printf(" (none)\n");
-    printf("\n");
+    OrdInner *in=(OrdInner*)node;
+    int i=ord_route(in,e);
+    OrdEntry k;
+    void *child=ord_insert_at(o,in->child[i],h-1,e,&k);
+    if (!child) return NULL;
+    int pos=i+1;
+    if (in->n < ORD_FAN) {
+        memmove(&in->key[pos+1], &in->key[pos], (size_t)(in->n-pos) * sizeof *in->key);
+        memmove(&in->child[pos+1], &in->child[pos], (size_t)(in->n-pos) * sizeof *in->child);
+        in->key[pos]=k;
+        in->child[pos]=child;
+        in->n++;
+        return NULL;
+    }
+    int keep=ORD_FAN/2;
+    OrdInner *r=(OrdInner*)ord_alloc(sizeof *r);
+    r->n=ORD_FAN-keep;
+    memcpy(r->key, &in->key[keep], (size_t)r->n * sizeof *in->key);
+    memcpy(r->child, &in->child[keep], (size_t)r->n * sizeof *in->child);
+    in->n=keep;
+    OrdInner *dst = pos <= keep ? in : r;
+    if (dst==r) pos-=keep;
+    memmove(&dst->key[pos+1], &dst->key[pos], (size_t)(dst->n-pos) * sizeof *in->key);
+    memmove(&dst->child[pos+1], &dst->child[pos], (size_t)(dst->n-pos) * sizeof *in->child);
+    dst->key[pos]=k;
+    dst->child[pos]=child;
+    dst->n++;
+    *sep=r->key[0];
+    return r;
+}
 
-    printf("%sAll Tasks%s (sorted by due; undated last)\n", C_BLUE(), S_RESET());
-    printf("Due              ID  Description\n");
-    printf("---------------- --- ------------------------------\n");
-    size_t limit = env_limit("CLITASK_ALL_LIMIT", 20);
-    size_t to_print = (n < limit) ? n : limit;
-    for (size_t i = 0; i < to_print; i++)
-	    print_task_row(&arr[i]->task);
-    if (n > limit)
-	    printf("... (%zu more)\n", n - limit);
-    
-    free(arr);
+static void ord_insert(OrderIndex *o, const OrdEntry *e){
+    OrdEntry sep;
+    void *r=ord_insert_at(o,o->root,o->height,e,&sep);
+    o->count++;
+    if (!r) return;
+    OrdInner *root=(OrdInner*)ord_alloc(sizeof *root);
+    root->n=2;
+    root->child[0]=o->root;
+    root->child[1]=r;
+    root->key[1]=sep;
+    memset(&root->key[0],0,sizeof root->key[0]);
+    o->root=root;
+    o->height++;
 }
 
-static void cmd_delete(int argc, char **argv){
-    if (argc<1){
-        printf("Usage: delete <id>\n");
-        return;
+static OrdLeaf *ord_leaf_for(const OrderIndex *o, const OrdEntry *k){
+    void *node=o->root;
+    for (int h=o->height; h>0; h--) {
+        const OrdInner *in=(const OrdInner*)node;
+        node=in->child[ord_route(in,k)];
     }
-    int id=0;
-    if(parseInt(argv[0],&id)!=0){
-        printf("Invalid id.\n");
-        return;
-    }
-    Task t;
-    if(!list_remove_by_id(&head,id,&t)){
-        printf("Task %d not found.\n", id);
-        return;
+    return (OrdLeaf*)node;
+}
+
+// Positions *it at the first entry not below k.
+static void ord_seek(const OrderIndex *o, const OrdEntry *k, OrdIter *it){
+    it->leaf=ord_leaf_for(o,k);
+    it->pos=ord_lower(it->leaf->e,it->leaf->n,k);
+}
+
+static const OrdEntry *ord_next(OrdIter *it){
+    while (it->leaf && it->pos >= it->leaf->n) {
+        it->leaf=it->leaf->next;
+        it->pos=0;
     }
-    list_push_head(&trash_head,t);
-    printf("%sRemoved%s #%d.\n", C_RED(), S_RESET(), id);
-    save_all_quiet();
+    return it->leaf ? &it->leaf->e[it->pos++] : NULL;
 }
 
-static void cmd_removed(int argc, char **argv){
-    (void)argc; (void)argv;
-    if(!trash_head){
-        printf("Removed is empty.\n");
-        return;
+// Copies the entries out in order, e.g. to rebuild a sparse tree.
+static OrdEntry *ord_collect(const OrderIndex *o){
+    OrdEntry *e=(OrdEntry*)ord_alloc((o->count ? o->count : 1) * sizeof *e);
+    size_t n=0;
+    for (const OrdLeaf *lf=o->first; lf; lf=lf->next) {
+        memcpy(e+n, lf->e, (size_t)lf->n * sizeof *e);
+        n+=(size_t)lf->n;
     }
-    printf("%sRemoved Tasks%s\n", C_RED(), S_RESET());
-    printf("Due              ID  Description\n");
-    printf("---------------- --- ------------------------------\n");
-    for(Node *n=trash_head;n;n=n->next){
-        char when[32];
-        fmt_when(n->task.due, when, sizeof when);
-        printf("%-16s %-3d %s\n", when, n->task.id, n->task.description);
+    return e;
+}
+
+static void ord_delete(OrderIndex **po, const OrdEntry *k){
+    OrderIndex *o=*po;
+    OrdLeaf *lf=ord_leaf_for(o,k);
+    int pos=ord_lower(lf->e,lf->n,k);
+    if (pos>=lf->n || ord_cmp(&lf->e[pos],k)!=0) return;
+    memmove(&lf->e[pos], &lf->e[pos+1], (size_t)(lf->n-pos-1) * sizeof *k);
+    lf->n--;
+    o->count--;
+    if (o->leaves > 1 && o->count*4 < o->leaves*ORD_FAN) {
+        OrdEntry *e=ord_collect(o);
+        *po=ord_build(e,o->count);
+        free(e);
+        ord_free(o);
     }
 }
 
-static void cmd_save(int argc, char **argv){
-    (void)argc; (void)argv;
-    save_all_verbose();
+static int cmp_ord_entry(const void *a, const void *b){
+    return ord_cmp((const OrdEntry*)a,(const OrdEntry*)b);
 }
 
-static volatile sig_atomic_t srv_running = 1;
+static bool intern_enabled(void){
+    static int on=-1;
+    if (on < 0) {
+        const char *v=getenv("CLITASK_INTERN");
+        on = !v || strcmp(v,"0")!=0;
+    }
+    return on;
+}
 
-static void handle_sigint(int sig){
-    (void)sig;
-    srv_running = 0;
+static void str_free(StrArena *a){
+    free(a->data);
+    free(a->slots);
+    memset(a,0,sizeof *a);
 }
 
-static void http_send_header(int fd, const char *status, const char *ctype){
-    dprintf(fd,
-        "HTTP/1.0 %s\r\n"
-        "Content-Type: %s; charset=utf-8\r\n"
-        "Cache-Control: no-store\r\n"
-        "Connection: close\r\n"
-        "\r\n",
-        status, ctype);
+static void str_reserve(StrArena *a, size_t extra){
+    if (a->len + extra <= a->cap) return;
+    size_t cap=a->cap ? a->cap : 4096;
+    while (cap < a->len + extra) cap*=2;
+    char *d=(char*)realloc(a->data,cap);
+    if(!d){perror("realloc"); exit(1);}
+    a->data=d;
+    a->cap=cap;
 }
 
-static void write_all_tasks_text(int fd){
-    size_t n=0;
-    Node **arr=collect_sorted(head,&n);
-    printf("Due              ID  Description\n");
-    printf("---------------- --- ------------------------------\n");
-    for (size_t i=0;i<n;i++){
-        char when[32];
-        fmt_when(arr[i]->task.due, when, sizeof when);
-        dprintf(fd, "%-16s %-3d %s\n",
-            when, arr[i]->task.id, arr[i]->task.description);
+// s must not point into a itself.
+static uint32_t str_append(StrArena *a, const char *s, size_t n){
+    if (!a->len) {
+        str_reserve(a,1);
+        a->data[a->len++]='\0';
     }
-    free(arr);
+    if (a->len + n + 1 > UINT32_MAX) {
+        fprintf(stderr,"descriptions exceed the 4 GiB string arena\n");
+        exit(1);
+    }
+    str_reserve(a,n+1);
+    uint32_t off=(uint32_t)a->len;
+    memcpy(a->data+off,s,n);
+    a->data[off+n]='\0';
+    a->len+=n+1;
+    return off;
 }
 
-static void write_all_tasks_json(int fd){
-    size_t n=0;
-    Node **arr=collect_sorted(head,&n);
-    dprintf(fd, "[\n");
-    for (size_t i=0;i<n;i++){
-        char when[32];
-        fmt_when(arr[i]->task.due, when, sizeof when);
-        dprintf(fd,
-            " {\"id\":%d,\"due\":%lld,\"when\":\"%s\",\"description\":\"",
-            arr[i]->task.id, (long long)arr[i]->task.due, when);
-        const char *s = arr[i]->task.description;
-        for (; *s; ++s){
-            if (*s=='\"' || *s=='\\') dprintf(fd, "\\%c", *s);
-            else if ((unsigned char)*s < 0x20) dprintf(fd, " ");
-            else dprintf(fd, "%c", *s);
-        }
-        dprintf(fd, "\"}%s\n", (i+1<n)? ",": "");
-    }
-    dprintf(fd, "]\n");
-    free(arr);
+// The bucket holding s, or the empty one where it belongs.
+static size_t str_probe(const StrArena *a, const char *s, size_t n){
+    size_t mask=a->slot_cap-1;
+    for (size_t b=(size_t)fnv1a(s,n) & mask;; b=(b+1) & mask) {
+        uint32_t off=a->slots[b];
+        if (!off || (strncmp(a->data+off,s,n)==0 && a->data[off+n]=='\0')) return b;
+    }
 }
 
-static void cmd_serve(int argc, char **argv){
-    if (argc < 1){
-        printf("Usage: serve <port>\n");
-        return;
-    }
-    int port=0;
-    if(parseInt(argv[0], &port)!=0 || port<=0 || port>65535){
-        printf("Invalid port.\n");
-        return;
-    }
-    int s = socket(AF_INET, SOCK_STREAM, 0);
-    if (s < 0){ perror("socket"); return; }
-    int one=1;
-    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
-    struct sockaddr_in addr;
-    memset(&addr, 0, sizeof addr);
-    addr.sin_family = AF_INET;
-    addr.sin_port = htons((unsigned short)port);
-    addr.sin_addr.s_addr = htonl(INADDR_ANY);
-    if (bind(s, (struct sockaddr*)&addr, sizeof addr) < 0){
-        perror("bind"); close(s); return;
+// Sized for `want` strings at under half load.
+static void str_rehash(StrArena *a, size_t want){
+    size_t cap=64;
+    while (cap < want*2) cap<<=1;
+    uint32_t *old=a->slots;
+    size_t old_cap=a->slot_cap;
+    a->slots=(uint32_t*)calloc(cap,sizeof *a->slots);
+    if(!a->slots){perror("calloc"); exit(1);}
+    a->slot_cap=cap;
+    for (size_t i=0;i<old_cap;i++) {
+        if (!old[i]) continue;
+        const char *s=a->data+old[i];
+        a->slots[str_probe(a,s,strlen(s))]=old[i];
     }
-    if (listen(s, 16) < 0){
-        perror("listen"); close(s); return;
+    free(old);
+}
+
+static void str_enter(StrArena *a, uint32_t off, size_t n){
+    if ((a->nslots+1)*2 > a->slot_cap) str_rehash(a,(a->nslots+1)*2);
+    size_t b=str_probe(a,a->data+off,n);
+    if (a->slots[b]) return;
+    a->slots[b]=off;
+    a->nslots++;
+}
+
+// s stored in a: the copy already there when interning, else a new one.
+static uint32_t str_put(StrArena *a, const char *s, size_t n){
+    if (!n) return 0;
+    if (!intern_enabled()) return str_append(a,s,n);
+    for (size_t off = a->indexed ? a->indexed : 1; off < a->len; ) {
+        size_t k=strlen(a->data+off);
+        if (k) str_enter(a,(uint32_t)off,k);
+        off+=k+1;
     }
-    printf("%sServing%s on http://127.0.0.1:%d (Ctrl+C to stop)\n",
-           C_BLUE(), S_RESET(), port);
-    signal(SIGINT, handle_sigint);
-    while (srv_running){
-        int c = accept(s, NULL, NULL);
-        if (c < 0){
-            if (errno == EINTR) break;
-            perror("accept"); continue;
-        }
-        char buf[2048];
-        ssize_t n = read(c, buf, sizeof buf - 1);
-        if (n < 0){ perror("read"); close(c); continue; }
-        buf[n>0?n:0] = '\0';
-        char method[8]={0}, path[256]={0};
-        if (sscanf(buf, "%7s %255s", method, path) != 2) {
-            http_send_header(c, "400 Bad Request", "text/plain");
-            dprintf(c, "Bad Request\n");
-            close(c);
-            continue;
-        }
-        reload_all_from_disk();
-        if (strcmp(path, "/json")==0){
-            http_send_header(c, "200 OK", "application/json");
-            write_all_tasks_json(c);
-        } else {
-            http_send_header(c, "200 OK", "text/plain");
-            dprintf(c, "CLI Task Manager (HTTP view)\n\n");
-            write_all_tasks_text(c);
-            dprintf(c, "\nTip: GET /json for JSON.\n");
-        }
-        close(c);
+    if ((a->nslots+1)*2 > a->slot_cap) str_rehash(a,(a->nslots+1)*2);
+    size_t b=str_probe(a,s,n);
+    if (!a->slots[b]) {
+        a->slots[b]=str_append(a,s,n);
+        a->nslots++;
     }
-    close(s);
-    printf("\nServer stopped.\n");
+    a->indexed=a->len;
+    return a->slots[b];
 }
 
-static bool due_within_minutes(time_t due, time_t now, int lead_min){
-    if (!due) return false;
-    double mins = difftime(due, now)/60.0;
-    return (mins <= lead_min && mins >= 0.0);
+// s copied into a as read from a store: not looked up or entered in the
+// intern table, which the next str_put catches up on.
+static uint32_t str_load(StrArena *a, const char *s, size_t n){
+    return n ? str_append(a,s,n) : 0;
 }
 
-#define SEEN_MAX 256
-static int seen_ids[SEEN_MAX];
-static size_t seen_len = 0;
+// Room for up to n more strings totalling `bytes`, ahead of a bulk load.
+static void str_expect(StrArena *a, size_t bytes, size_t n){
+    str_reserve(a,bytes+n+1);
+}
 
-static bool seen_has(int id){
-    for (size_t i=0;i<seen_len;i++)
-        if (seen_ids[i]==id) return true;
-    return false;
+static const char *task_desc(const Task *t){
+    return strs.data ? strs.data + t->desc : "";
 }
 
-static void seen_add(int id){
-    if (seen_len < SEEN_MAX) seen_ids[seen_len++] = id;
+static bool task_desc_ok(const Task *t){
+    if (!t->desc) return !t->len;
+    return (size_t)t->desc + t->len < strs.len && strs.data[t->desc + t->len]=='\0';
 }
 
-static void notify_task(const Task *t, int argc, char **argv){
-    if (argc <= 0){
-        char when[32];
-        fmt_when(t->due, when, sizeof when);
-        printf("[REMINDER] #%d due %s : %s\n",
-               t->id, when, t->description);
-        fflush(stdout);
-        return;
+static size_t tl_bucket(const TaskList *l, int id){
+    return ((uint32_t)id * 2654435761u) & (l->index_cap - 1);
+}
+
+static long tl_lookup(const TaskList *l, int id){
+    if (!l->index_cap) return -1;
+    size_t b=tl_bucket(l,id);
+    while (l->index[b] >= 0) {
+        if (l->recs[l->index[b]].id==id) return (long)b;
+        b=(b+1) & (l->index_cap - 1);
     }
-    char cmd[1024];
-    size_t off = 0;
-    for (int i=0; i<argc; i++){
-        int w = snprintf(cmd+off, sizeof cmd - off, "%s%s",
-                         (i? " ":""), argv[i]);
-        if (w < 0 || (size_t)w >= sizeof cmd - off) break;
-        off += (size_t)w;
+    return -1;
+}
+
+static void tl_index_put(TaskList *l, int id, size_t slot){
+    size_t b=tl_bucket(l,id);
+    while (l->index[b] >= 0) b=(b+1) & (l->index_cap - 1);
+    l->index[b]=(int32_t)slot;
+}
+
+// Backward-shift deletion keeps probe chains intact without tombstones.
+static void tl_index_del(TaskList *l, size_t b){
+    size_t mask=l->index_cap - 1;
+    for (size_t j=(b+1)&mask; l->index[j] >= 0; j=(j+1)&mask) {
+        size_t home=tl_bucket(l,l->recs[l->index[j]].id);
+        if (((j-home)&mask) >= ((j-b)&mask)) {
+            l->index[b]=l->index[j];
+            b=j;
+        }
     }
-    char when[32];
-    fmt_when(t->due, when, sizeof when);
-    int w = snprintf(cmd+off, sizeof cmd - off,
-                     " \"%s (due %s)\"", t->description, when);
-    (void)w;
-    system(cmd);
+    l->index[b]=-1;
 }
 
-static void detach_from_terminal(void){
-    if (setsid() < 0) { }
-    signal(SIGHUP, SIG_IGN);
+// Rebuilds the index for the records in [0, len), sized for `want` ids.
+static void tl_reindex(TaskList *l, size_t want){
+    size_t cap=16;
+    while (cap < want*4) cap<<=1;
+    int32_t *ix=(int32_t*)malloc(cap * sizeof *ix);
+    if(!ix){perror("malloc"); exit(1);}
+    memset(ix,0xff,cap * sizeof *ix);
+    free(l->index);
+    l->index=ix;
+    l->index_cap=cap;
+    for (size_t i=0;i<l->len;i++)
+        if (l->recs[i].id) tl_index_put(l,l->recs[i].id,i);
 }
 
-static void cmd_watch(int argc, char **argv){
-    int interval = (argc>=1)? atoi(argv[0]) : 60;
-    if (interval <= 0) interval = 60;
-    int lead_min = (argc>=2)? atoi(argv[1]) : 10;
-    if (lead_min <= 0) lead_min = 10;
-    int notify_argc = (argc>=3)? (argc-2) : 0;
-    char **notify_argv = (argc>=3)? (&argv[2]) : NULL;
-    pid_t pid = fork();
-    if (pid < 0){ perror("fork"); return; }
-    if (pid > 0){
-        printf("Watcher started (pid=%d). Scanning every %ds; lead=%dmin.\n",
-               (int)pid, interval, lead_min);
-        return;
+static void tl_compact(TaskList *l){
+    uint32_t *moved = l->order ? (uint32_t*)ord_alloc(l->len * sizeof *moved) : NULL;
+    size_t w=0;
+    for (size_t i=0;i<l->len;i++) {
+        if (!l->recs[i].id) continue;
+        if (moved) moved[i]=(uint32_t)w;
+        l->recs[w++]=l->recs[i];
     }
-    detach_from_terminal();
-    while (1){
-        reload_all_from_disk();
-        time_t now = time(NULL);
-        for (Node *p=head; p; p=p->next){
-            if (!p->task.due) continue;
-            if (due_within_minutes(p->task.due, now, lead_min) &&
-                !seen_has(p->task.id)){
-                notify_task(&p->task, notify_argc, notify_argv);
-                seen_add(p->task.id);
-            }
-        }
-        sleep((unsigned)interval);
+    l->len=w;
+    tl_reindex(l,l->live);
+    if (moved) {
+        for (OrdLeaf *lf=l->order->first; lf; lf=lf->next)
+            for (int k=0;k<lf->n;k++) lf->e[k].slot=moved[lf->e[k].slot];
+        free(moved);
     }
 }
 
-typedef void (*handler_t)(int,char**);
-typedef struct { const char *name; handler_t fn; } Command;
+static void tl_reserve(TaskList *l, size_t want){
+    if (want <= l->cap) return;
+    size_t cap=l->cap ? l->cap : 16;
+    while (cap < want) cap*=2;
+    Task *r;
+    if (l->map) {
+        r=(Task*)malloc(cap * sizeof *r);
+        if (r) memcpy(r,l->recs,l->len * sizeof *r);
+        munmap(l->map,l->map_len);
+        l->map=NULL;
+    } else {
+        r=(Task*)realloc(l->recs,cap * sizeof *r);
+    }
+    if(!r){perror("malloc"); exit(1);}
+    l->recs=r;
+    l->cap=cap;
+}
 
-static void cmd_delete_alias(int argc, char **argv){
-    cmd_delete(argc, argv);
+static OrdEntry tl_ord_entry(const TaskList *l, size_t slot){
+    OrdEntry e;
+    e.due=ord_key(l->recs[slot].due);
+    e.id=l->recs[slot].id;
+    e.slot=(uint32_t)slot;
+    return e;
 }
 
-static Command CMDS[] = {
-    {"add", cmd_add},
+static void tl_rule_add(TaskList *l, int id){
+    if (l->nrules==l->rules_cap) {
+        l->rules_cap = l->rules_cap ? l->rules_cap*2 : 8;
+        int32_t *r=(int32_t*)realloc(l->rules, l->rules_cap * sizeof *r);
+        if(!r){perror("realloc"); exit(1);}
+        l->rules=r;
+    }
+    l->rules[l->nrules++]=id;
+}
+
+static void tl_rule_del(TaskList *l, int id){
+    for (size_t i=0;i<l->nrules;i++)
+        if (l->rules[i]==id) { l->rules[i]=l->rules[--l->nrules]; return; }
+}
+
+// Indexes records written in bulk at [from, len); invalid or duplicate
+// ids and descriptions outside the arena become holes. Returns the
+// largest id seen.
+static int tl_index_tail(TaskList *l, size_t from){
+    size_t len=l->len;
+    int max_id=0;
+    if ((l->live + (len-from))*2 > l->index_cap) {
+        l->len=from;
+        tl_reindex(l, l->live + (len-from));
+        l->len=len;
+    }
+    for (size_t i=from;i<len;i++) {
+        Task *t=&l->recs[i];
+        if (t->id<=0 || !task_desc_ok(t) || tl_lookup(l,t->id)>=0 ||
+            (t->repeat && (!t->due || !repeat_ok(t->repeat)))) {
+            if (t->id) t->id=0;
+            continue;
+        }
+        tl_index_put(l,t->id,i);
+        l->live++;
+        if (t->id > max_id) max_id=t->id;
+        if (t->repeat) tl_rule_add(l,t->id);
+        else if (l->order) {
+            OrdEntry e=tl_ord_entry(l,i);
+            ord_insert(l->order,&e);
+        }
+    }
+    while (l->len && !l->recs[l->len-1].id) l->len--;
+    return max_id;
+}
+
+static bool tl_push(TaskList *l, Task t){
+    if (t.id<=0 || tl_lookup(l,t.id)>=0) return false;
+    if (l->len==l->cap) {
+        if (l->len - l->live > l->live) tl_compact(l);
+        else tl_reserve(l,l->len+1);
+    }
+    size_t slot=l->len++;
+    l->recs[slot]=t;
+    l->live++;
+    if (l->live*2 > l->index_cap) tl_reindex(l,l->live);
+    else tl_index_put(l,t.id,slot);
+    if (t.repeat) tl_rule_add(l,t.id);
+    else if (l->order) {
+        OrdEntry e=tl_ord_entry(l,slot);
+        ord_insert(l->order,&e);
+    }
+    return true;
+}
+
+static Task *tl_find(TaskList *l, int id){
+    long b=tl_lookup(l,id);
+    return b<0 ? NULL : &l->recs[l->index[b]];
+}
+
+static bool tl_remove(TaskList *l, int id, Task *out){
+    long b=tl_lookup(l,id);
+    if (b<0) return false;
+    size_t slot=(size_t)l->index[b];
+    if(out)*out=l->recs[slot];
+    if (l->recs[slot].repeat) tl_rule_del(l,id);
+    else if (l->order) {
+        OrdEntry e=tl_ord_entry(l,slot);
+        ord_delete(&l->order,&e);
+    }
+    tl_index_del(l,(size_t)b);
+    l->recs[slot].id=0;
+    l->live--;
+    while (l->len && !l->recs[l->len-1].id) l->len--;
+    return true;
+}
+
+static void tl_free(TaskList *l){
+    if (l->map) munmap(l->map,l->map_len);
+    else free(l->recs);
+    free(l->index);
+    ord_free(l->order);
+    free(l->rules);
+    memset(l,0,sizeof *l);
+}
+
+// The ordered index, built on first use.
+static OrderIndex *tl_order(TaskList *l){
+    if (l->order) return l->order;
+    OrdEntry *e=(OrdEntry*)ord_alloc((l->live ? l->live : 1) * sizeof *e);
+    size_t n=0;
+    for (size_t i=0;i<l->len;i++)
+        if (l->recs[i].id && !l->recs[i].repeat) e[n++]=tl_ord_entry(l,i);
+    qsort(e,n,sizeof *e,cmp_ord_entry);
+    l->order=ord_build(e,n);
+    free(e);
+    return l->order;
+}
+
+// Positions *it at the first task ordered at or after (due, id).
+static void tl_seek(TaskList *l, time_t due, int id, OrdIter *it){
+    OrdEntry k;
+    k.due=ord_key(due);
+    k.id=id;
+    k.slot=0;
+    ord_seek(tl_order(l),&k,it);
+}
+
+static void tl_seek_first(TaskList *l, OrdIter *it){
+    OrderIndex *o=tl_order(l);
+    it->leaf=o->first;
+    it->pos=0;
+}
+
+static const Task *tl_next(const TaskList *l, OrdIter *it){
+    const OrdEntry *e=ord_next(it);
+    return e ? &l->recs[e->slot] : NULL;
+}
+
+// Tasks in (due, id) order from (from, id) on, one-off tasks and the
+// occurrences of recurring ones merged; from == 0 and id == 0 start at the
+// beginning. With `to` set, only what falls before it, every occurrence
+// included (from today on when starting at the beginning). With to == 0,
+// everything after, each rule once: its first occurrence from `since` or
+// today, whichever is later, if that is not before (from, id), so pages
+// taken with a cursor agree. Occurrences come back as a copy of the rule
+// with due set, valid until the next call.
+typedef struct {
+    TaskList    *l;
+    OrdIter      it;
+    const Task  *one;
+    const Task **rule;
+    time_t      *next;     // per rule, 0 = no more occurrences
+    size_t       nrules;
+    time_t       to;
+    Task         cur;
+} DueIter;
+
+static void due_begin(DueIter *d, TaskList *l, time_t from, int id,
+                      time_t since, time_t to){
+    memset(d,0,sizeof *d);
+    d->l=l;
+    d->to=to;
+    bool first = !from && !id;
+    if (first) tl_seek_first(l,&d->it);
+    else tl_seek(l,from,id,&d->it);
+    d->one=tl_next(l,&d->it);
+    if (!l->nrules) return;
+    d->rule=(const Task**)malloc(l->nrules * sizeof *d->rule);
+    d->next=(time_t*)malloc(l->nrules * sizeof *d->next);
+    if(!d->rule || !d->next){perror("malloc"); exit(1);}
+    time_t start=from;
+    if (!to || first) {
+        start=local_midnight(time(NULL),0);
+        if (start < since) start=since;
+    }
+    int64_t key=ord_key(from);
+    for (size_t i=0;i<l->nrules;i++) {
+        const Task *r=tl_find(l,l->rules[i]);
+        if (!r) continue;
+        time_t at=repeat_next(r,start);
+        if (to) {
+            if (at==from && r->id < id) at=repeat_next(r,at+1);
+            if (at >= to) continue;
+        } else if (!first && (at < key || (at==key && r->id < id))) {
+            continue;
+        }
+        d->rule[d->nrules]=r;
+        d->next[d->nrules++]=at;
+    }
+}
+
+static const Task *due_next(DueIter *d){
+    const Task *o=d->one;
+    if (o && d->to && (!o->due || o->due >= d->to)) o=d->one=NULL;
+    size_t best=d->nrules;
+    for (size_t i=0;i<d->nrules;i++) {
+        if (!d->next[i]) continue;
+        if (best==d->nrules || d->next[i] < d->next[best] ||
+            (d->next[i]==d->next[best] && d->rule[i]->id < d->rule[best]->id))
+            best=i;
+    }
+    if (best < d->nrules) {
+        const Task *r=d->rule[best];
+        time_t at=d->next[best];
+        if (!o || at < ord_key(o->due) || (at==ord_key(o->due) && r->id < o->id)) {
+            d->cur=*r;
+            d->cur.due=at;
+            at = d->to ? repeat_next(r,at+1) : 0;
+            d->next[best] = at < d->to ? at : 0;
+            return &d->cur;
+        }
+    }
+    if (!o) return NULL;
+    d->one=tl_next(d->l,&d->it);
+    return o;
+}
+
+static void due_end(DueIter *d){
+    free(d->rule);
+    free(d->next);
+}
+
+// An active task as listings outside DueIter show it: a recurring one at
+// its next occurrence from today, copied into vals[*nvals] (room for
+// every rule).
+static const Task *task_upcoming(const Task *t, Task *vals, size_t *nvals){
+    if (!t->repeat) return t;
+    Task *v=&vals[(*nvals)++];
+    *v=*t;
+    v->due=repeat_next(t, local_midnight(time(NULL),0));
+    return v;
+}
+
+// Descriptions of tasks dropped or reloaded stay in the arena until it
+// has doubled since the last compaction; then the ones tasks and trash
+// still point at are copied into a fresh arena. Callers make sure no
+// other list (an HTTP stream's archived rows) holds offsets into it.
+static void str_maybe_compact(void){
+    if (strs.len < 2*strs.kept + (1u<<20)) return;
+    StrArena fresh;
+    memset(&fresh,0,sizeof fresh);
+    TaskList *ls[2]={&tasks,&trash};
+    for (int k=0;k<2;k++)
+        for (size_t i=0;i<ls[k]->len;i++) {
+            Task *t=&ls[k]->recs[i];
+            if (t->id) t->desc=str_put(&fresh,task_desc(t),t->len);
+        }
+    str_free(&strs);
+    strs=fresh;
+    strs.kept=strs.len;
+}
+
+// ---------- Persistence & storage ----------
+
+// Text snapshots are parsed without stdio: the file is read in one go,
+// newlines are located with memchr, and the lines are split into
+// per-thread ranges that parse straight into their own slots of the arena
+// (CLITASK_THREADS, default: online CPUs; small files use one thread).
+// Indexing and the nextId computation then run once over the whole range
+// in file order. CLITASK_LOAD_STATS=1 reports lines per second on stderr.
+
+#define PARSE_MIN_CHUNK (512*1024)
+#define PARSE_MAX_THREADS 16
+
+static const char *skip_blanks(const char *p, const char *end){
+    while (p<end && (*p==' ' || *p=='\t' || *p=='\v' || *p=='\f' || *p=='\r')) p++;
+    return p;
+}
+
+static const char *scan_ll(const char *p, const char *end, long long *out){
+    bool neg=false;
+    if (p<end && (*p=='-' || *p=='+')) neg=(*p++=='-');
+    const char *digits=p;
+    unsigned long long v=0;
+    while (p<end && *p>='0' && *p<='9') v=v*10 + (unsigned)(*p++ - '0');
+    if (p==digits) return NULL;
+    *out = neg ? -(long long)v : (long long)v;
+    return p;
+}
+
+// One "<id> <due>[/<rule>] <description>" line (no newline) into t, with
+// the description left at *desc (t->len bytes) for the caller to store;
+// false for lines the old sscanf("%d %lld %255[^\n]") rejected. A negative
+// id marks a deleted occurrence "-<id> <due>" of recurring task <id>,
+// which has no description.
+static bool parse_task_line(const char *p, const char *end, Task *t, const char **desc){
+    long long id=0, due=0;
+    uint32_t repeat=0;
+    p=skip_blanks(p,end);
+    if (!(p=scan_ll(p,end,&id))) return false;
+    p=skip_blanks(p,end);
+    if (!(p=scan_ll(p,end,&due))) return false;
+    if (p<end && *p=='/') {
+        const char *rule=++p;
+        while (p<end && *p!=' ' && *p!='\t' && *p!='\r') p++;
+        if (!parse_repeat(rule,(size_t)(p-rule),&repeat)) return false;
+    }
+    p=skip_blanks(p,end);
+    while (end>p && end[-1]=='\r') end--;
+    if (p>=end && id>=0) return false;
+    t->id=(int)id;
+    t->len=(uint32_t)(end-p);
+    t->due=(time_t)due;
+    t->desc=0;
+    t->repeat=repeat;
+    *desc=p;
+    return true;
+}
+
+// "<due>" or "<due>/<rule>", as the stores and the journal write it.
+static void fmt_due_rule(const Task *t, char *out, size_t L){
+    int n=snprintf(out,L,"%lld",(long long)t->due);
+    if (t->repeat && n>0 && (size_t)n<L) {
+        out[n++]='/';
+        repeat_name(t->repeat,out+n,L-(size_t)n);
+    }
+}
+
+// Threads leave each description as an offset into the file buffer;
+// they are moved into the string arena afterwards, in file order.
+typedef struct {
+    const char *buf;
+    const char *begin;
+    const char *end;
+    Task       *slots;   // one per line in [begin, end)
+} ParseChunk;
+
+static void *parse_chunk(void *arg){
+    ParseChunk *c=(ParseChunk*)arg;
+    Task *t=c->slots;
+    for (const char *p=c->begin; p<c->end; t++) {
+        const char *nl=memchr(p,'\n',(size_t)(c->end-p));
+        const char *eol = nl ? nl : c->end;
+        const char *desc;
+        if (parse_task_line(p,eol,t,&desc)) t->desc=(uint32_t)(desc - c->buf);
+        else t->id=0;
+        p = eol + 1;
+    }
+    return NULL;
+}
+
+static size_t parse_threads(size_t bytes){
+    size_t want=env_limit("CLITASK_THREADS", 0);
+    if (!want) {
+        long cpus=sysconf(_SC_NPROCESSORS_ONLN);
+        want = cpus>0 ? (size_t)cpus : 1;
+    }
+    if (want > PARSE_MAX_THREADS) want = PARSE_MAX_THREADS;
+    size_t by_size = bytes / PARSE_MIN_CHUNK;
+    if (want > by_size) want = by_size;
+    return want ? want : 1;
+}
+
+static char *read_whole(const char *path, size_t *len){
+    int fd=open(path,O_RDONLY);
+    if (fd<0) return NULL;
+    struct stat st;
+    if (fstat(fd,&st)<0) { close(fd); return NULL; }
+    size_t cap=(size_t)st.st_size + 1, n=0;
+    char *buf=(char*)malloc(cap);
+    if(!buf){perror("malloc"); exit(1);}
+    for (;;) {
+        if (n==cap) {
+            char *p=(char*)realloc(buf,cap*=2);
+            if(!p){perror("realloc"); exit(1);}
+            buf=p;
+        }
+        ssize_t r=read(fd,buf+n,cap-n);
+        if (r<0 && errno==EINTR) continue;
+        if (r<0) {
+            int e=errno;
+            free(buf);
+            close(fd);
+            errno=e;
+            return NULL;
+        }
+        if (r==0) break;
+        n+=(size_t)r;
+    }
+    close(fd);
+    *len=n;
+    return buf;
+}
+
+static bool load_file_text(const char *path, TaskList *out, int *io_nextId) {
+    double t0=mono_seconds();
+    size_t len=0;
+    char *buf=read_whole(path,&len);
+    if (!buf) {
+        if (errno==ENOENT) return true;
+        perror(path);
+        return false;
+    }
+    if (len > UINT32_MAX) {
+        fprintf(stderr,"%s: larger than 4 GiB\n",path);
+        free(buf);
+        return false;
+    }
+    const char *end=buf+len;
+
+    size_t nthreads=parse_threads(len);
+    ParseChunk chunks[PARSE_MAX_THREADS];
+    size_t counts[PARSE_MAX_THREADS];
+    pthread_t tids[PARSE_MAX_THREADS];
+    size_t lines=0;
+    const char *p=buf;
+    for (size_t k=0;k<nthreads;k++) {
+        const char *stop = k+1==nthreads ? end : buf + len*(k+1)/nthreads;
+        if (stop < p) stop = p;
+        if (stop < end) {
+            const char *nl=memchr(stop,'\n',(size_t)(end-stop));
+            stop = nl ? nl+1 : end;
+        }
+        chunks[k].buf=buf;
+        chunks[k].begin=p;
+        chunks[k].end=stop;
+        counts[k]=0;
+        for (const char *q=p; q<stop; counts[k]++) {
+            const char *nl=memchr(q,'\n',(size_t)(stop-q));
+            q = nl ? nl+1 : stop;
+        }
+        lines+=counts[k];
+        p=stop;
+    }
+    if (!lines) { free(buf); return true; }
+    size_t base=out->len;
+    tl_reserve(out, base + lines);
+    for (size_t k=0, slot=base;k<nthreads;slot+=counts[k++])
+        chunks[k].slots=&out->recs[slot];
+    size_t started=0;
+    for (size_t k=1;k<nthreads;k++, started++)
+        if (pthread_create(&tids[k],NULL,parse_chunk,&chunks[k])!=0) break;
+    parse_chunk(&chunks[0]);
+    for (size_t k=1;k<=started;k++) pthread_join(tids[k],NULL);
+    for (size_t k=started+1;k<nthreads;k++) parse_chunk(&chunks[k]);
+    str_expect(&strs,len,lines);
+    for (size_t i=base;i<base+lines;i++) {
+        Task *t=&out->recs[i];
+        if (t->id < 0) {
+            skip_add(-t->id,t->due);
+            t->id=0;
+        } else if (t->id) {
+            t->desc=str_load(&strs, buf + t->desc, t->len);
+        }
+    }
+    free(buf);
+
+    out->len=base+lines;
+    int max_id=tl_index_tail(out,base);
+    if (io_nextId && max_id >= *io_nextId) *io_nextId = max_id + 1;
+
+    const char *stats=getenv("CLITASK_LOAD_STATS");
+    if (stats && strcmp(stats,"0")!=0) {
+        double secs=mono_seconds()-t0;
+        fprintf(stderr,"load %s: %zu lines in %.3fs (%.0f lines/s, %zu thread%s)\n",
+                path, lines, secs, secs>0 ? (double)lines/secs : 0.0,
+                nthreads, nthreads==1 ? "" : "s");
+    }
+    return true;
+}
+
+// Writers serialize on an fcntl lock over byte 0 of <active>.lock and
+// append to the journal without syncing. Durability is a group commit:
+// byte 1 guards the journal offset known to be on disk (stored at byte 8),
+// and whoever takes it next fsyncs once for every record appended so far.
+// CLITASK_FSYNC=0 skips all fsyncs.
+
+#define LOCK_STORE 0
+#define LOCK_SYNC  1
+#define LOCK_MARK  8
+
+static int lock_fd = -1;
+static int lock_depth = 0;
+static off_t journal_end = 0;    // end of our unsynced appends, 0 = none
+
+static bool store_sync(void){
+    const char *s=getenv("CLITASK_FSYNC");
+    return !s || strcmp(s,"0")!=0;
+}
+
+static bool lock_range(off_t start, short type){
+    if (lock_fd < 0) {
+        lock_fd=open(lock_file, O_RDWR|O_CREAT, 0644);
+        if (lock_fd < 0) return false;      // read-only store: run unlocked
+        fcntl(lock_fd, F_SETFD, FD_CLOEXEC);
+    }
+    struct flock fl;
+    memset(&fl,0,sizeof fl);
+    fl.l_type=type;
+    fl.l_whence=SEEK_SET;
+    fl.l_start=start;
+    fl.l_len=1;
+    while (fcntl(lock_fd, F_SETLKW, &fl) < 0)
+        if (errno != EINTR) return false;
+    return true;
+}
+
+// Nests; a process already holding the lock keeps its mode.
+static void store_lock(short type){
+    if (lock_depth++ == 0) lock_range(LOCK_STORE, type);
+}
+
+static void store_unlock(void){
+    if (--lock_depth == 0 && lock_fd >= 0) lock_range(LOCK_STORE, F_UNLCK);
+}
+
+static off_t synced_mark(void){
+    int64_t v=0;
+    if (pread(lock_fd, &v, sizeof v, LOCK_MARK) != (ssize_t)sizeof v) return 0;
+    return (off_t)v;
+}
+
+static void set_synced_mark(off_t off){
+    int64_t v=(int64_t)off;
+    (void)!pwrite(lock_fd, &v, sizeof v, LOCK_MARK);
+}
+
+// Returns once the journal is durable up to `end`.
+static void journal_commit(off_t end){
+    if (!store_sync() || !lock_range(LOCK_SYNC, F_WRLCK)) return;
+    if (synced_mark() < end) {
+        int fd=open(journal_file, O_WRONLY);
+        if (fd >= 0) {
+            struct stat st;
+            if (fstat(fd,&st)==0 && fsync(fd)==0) set_synced_mark(st.st_size);
+            close(fd);
+        }
+    }
+    lock_range(LOCK_SYNC, F_UNLCK);
+}
+
+// Makes a rename in path's directory durable.
+static void fsync_dir_of(const char *path){
+    if (!store_sync()) return;
+    char dir[600];
+    const char *slash=strrchr(path,'/');
+    if (!slash) strcpy(dir,".");
+    else if (slash==path) strcpy(dir,"/");
+    else snprintf(dir,sizeof dir,"%.*s",(int)(slash-path),path);
+    int fd=open(dir, O_RDONLY);
+    if (fd < 0) return;
+    fsync(fd);
+    close(fd);
+}
+
+// Flushes, syncs and closes f, then renames tmp over path.
+static bool publish_file(FILE *f, const char *tmp, const char *path){
+    bool ok = fflush(f)==0 && (!store_sync() || fsync(fileno(f))==0);
+    ok = fclose(f)==0 && ok;
+    ok = ok && rename(tmp,path)==0;
+    if (!ok) {
+        perror("write");
+        remove(tmp);
+        return false;
+    }
+    fsync_dir_of(path);
+    return true;
+}
+
+// Written beside the target and renamed over it, so readers see the old
+// file or the new one, never a prefix.
+static bool save_file_text(const char *path, const TaskList *l, bool verbose){
+    char tmp[600];
+    snprintf(tmp,sizeof tmp,"%s.tmp",path);
+    FILE *f=fopen(tmp,"w");
+    if(!f){perror("open for write"); return false;}
+    for(size_t i=0;i<l->len;i++){
+        const Task *t=&l->recs[i];
+        if (!t->id) continue;
+        if (!t->repeat) {
+            fprintf(f,"%d %lld %s\n", t->id, (long long)t->due, task_desc(t));
+            continue;
+        }
+        char when[48];
+        fmt_due_rule(t,when,sizeof when);
+        fprintf(f,"%d %s %s\n", t->id, when, task_desc(t));
+        for (size_t k=skip_lower(t->id,0); k<skips.n && skips.v[k].id==t->id; k++)
+            fprintf(f,"-%d %lld\n", t->id, (long long)skips.v[k].due);
+    }
+    if (!publish_file(f,tmp,path)) return false;
+    if(verbose) printf("Saved %s\n", path);
+    return true;
+}
+
+// Binary store (CLITASK_STORE=binary): a fixed header, fixed-size
+// records in native byte order, then the descriptions the records point
+// into (NUL-terminated, offset 0 empty, shared when interning). A load is
+// one mmap and a walk over the records with no text parsing. Where Task
+// has the same layout as StoreRecord and the arena is still empty, the
+// arena is a copy of the description block and the records stay in a
+// private mapping whose pages are copied only when written. Deleted
+// occurrences of recurring tasks (header.skips of them) sit between the
+// records and the descriptions. Version 2 stores (no skips block) and
+// version 1 stores (fixed 256-byte descriptions) are still read; saving
+// writes the current version. Bump STORE_VERSION whenever the file
+// layout changes.
+
+#define STORE_MAGIC   "CLTASKS"
+#define STORE_VERSION 3u
+
+typedef struct {
+    char     magic[8];
+    uint32_t version;
+    uint32_t record_size;
+    uint64_t count;
+    int32_t  next_id;
+    uint32_t skips;
+} StoreHeader;
+
+typedef struct {
+    int32_t  id;
+    uint32_t len;
+    int64_t  due;
+    uint32_t desc;
+    uint32_t repeat;
+} StoreRecord;
+
+typedef struct {
+    int32_t  id;
+    uint32_t pad;
+    int64_t  due;
+} StoreSkip;
+
+typedef struct {
+    int32_t  id;
+    uint32_t flags;
+    int64_t  due;
+    char     description[256];
+} StoreRecordV1;
+
+static bool load_file_bin(const char *path, TaskList *out, int *io_nextId) {
+    int fd=open(path,O_RDONLY);
+    if (fd<0) {
+        if (errno==ENOENT) return true;
+        perror(path);
+        return false;
+    }
+    struct stat st;
+    if(fstat(fd,&st)<0 || st.st_size==0){ close(fd); return true; }
+    size_t map_len=(size_t)st.st_size;
+    void *map=mmap(NULL,map_len,PROT_READ|PROT_WRITE,MAP_PRIVATE,fd,0);
+    close(fd);
+    if(map==MAP_FAILED){ perror("mmap"); return false; }
+    const StoreHeader *hd=(const StoreHeader*)map;
+    size_t rsize = map_len < sizeof *hd ? 0 :
+                   hd->version==STORE_VERSION || hd->version==2 ? sizeof(StoreRecord) :
+                   hd->version==1 ? sizeof(StoreRecordV1) : 0;
+    // Before version 3 the skips field was reserved and always zero.
+    bool has_skips = rsize && hd->version==STORE_VERSION;
+    if (!rsize || memcmp(hd->magic,STORE_MAGIC,sizeof hd->magic)!=0 ||
+        hd->record_size!=rsize || hd->count > (map_len - sizeof *hd) / rsize ||
+        (has_skips && hd->skips >
+         (map_len - sizeof *hd - hd->count*rsize) / sizeof(StoreSkip))) {
+        fprintf(stderr,"%s: not a task store (version %u expected)\n",
+                path, STORE_VERSION);
+        munmap(map,map_len);
+        return false;
+    }
+    if (io_nextId && hd->next_id > *io_nextId) *io_nextId = hd->next_id;
+    size_t count=(size_t)hd->count;
+    size_t nskips = has_skips ? hd->skips : 0;
+    char *recs=(char*)map + sizeof *hd;
+    const StoreSkip *sk=(const StoreSkip*)(void*)(recs + count*rsize);
+    for (size_t i=0;i<nskips;i++) skip_add(sk[i].id,(time_t)sk[i].due);
+    const char *blob=(const char*)(sk + nskips);
+    size_t blob_len=map_len - (size_t)(blob - (const char*)map);
+    bool in_place = rsize==sizeof(StoreRecord) &&
+                    sizeof(Task)==sizeof(StoreRecord) &&
+                    offsetof(Task,len)==offsetof(StoreRecord,len) &&
+                    offsetof(Task,due)==offsetof(StoreRecord,due) &&
+                    offsetof(Task,desc)==offsetof(StoreRecord,desc) &&
+                    offsetof(Task,repeat)==offsetof(StoreRecord,repeat) &&
+                    out->len==0 && strs.len==0 && blob_len <= UINT32_MAX &&
+                    (!blob_len || (!blob[0] && !blob[blob_len-1]));
+    size_t base=out->len;
+    if (in_place) {
+        // Only the id index is built; the records stay in the mapping.
+        tl_free(out);
+        out->map=map;
+        out->map_len=map_len;
+        out->recs=(Task*)(void*)recs;
+        out->cap=count;
+        base=0;
+        str_reserve(&strs,blob_len);
+        memcpy(strs.data,blob,blob_len);
+        strs.len=blob_len;
+    } else {
+        tl_reserve(out,base+count);
+        for (size_t i=0;i<count;i++) {
+            Task *t=&out->recs[base+i];
+            memset(t,0,sizeof *t);
+            if (rsize==sizeof(StoreRecordV1)) {
+                const StoreRecordV1 *r=(const StoreRecordV1*)(void*)(recs + i*rsize);
+                size_t n=strnlen(r->description,sizeof r->description);
+                t->id=r->id;
+                t->due=(time_t)r->due;
+                t->len=(uint32_t)n;
+                t->desc=str_load(&strs,r->description,n);
+                continue;
+            }
+            const StoreRecord *r=(const StoreRecord*)(void*)(recs + i*rsize);
+            if (r->len && ((size_t)r->desc + r->len >= blob_len || blob[r->desc + r->len]))
+                continue;       // points outside the block: a hole
+            t->id=r->id;
+            t->due=(time_t)r->due;
+            t->len=r->len;
+            t->repeat=r->repeat;
+            t->desc=str_load(&strs,blob + r->desc,r->len);
+        }
+    }
+    out->len=base+count;
+    int max_id=tl_index_tail(out,base);
+    if (io_nextId && max_id >= *io_nextId) *io_nextId = max_id + 1;
+    if (!in_place) munmap(map,map_len);
+    return true;
+}
+
+// Written to a temp file and renamed over the store, so a live mapping of
+// the old file never sees it truncated underneath it. The description
+// block is built while the records are written and holds only theirs.
+static bool save_file_bin(const char *path, const TaskList *l, bool verbose){
+    char tmp[600];
+    snprintf(tmp,sizeof tmp,"%s.tmp",path);
+    FILE *f=fopen(tmp,"wb");
+    if(!f){perror("open for write"); return false;}
+    StoreHeader hd;
+    memset(&hd,0,sizeof hd);
+    memcpy(hd.magic,STORE_MAGIC,sizeof hd.magic);
+    hd.version=STORE_VERSION;
+    hd.record_size=sizeof(StoreRecord);
+    hd.count=l->live;
+    hd.next_id=nextId;
+    for (size_t k=0;k<skips.n;k++)
+        if (tl_lookup(l,skips.v[k].id)>=0) hd.skips++;
+    fwrite(&hd,sizeof hd,1,f);
+    StrArena blob;
+    memset(&blob,0,sizeof blob);
+    for(size_t i=0;i<l->len;i++){
+        const Task *t=&l->recs[i];
+        if (!t->id) continue;
+        StoreRecord r;
+        memset(&r,0,sizeof r);
+        r.id=t->id;
+        r.len=t->len;
+        r.due=(int64_t)t->due;
+        r.desc=str_put(&blob,task_desc(t),t->len);
+        r.repeat=t->repeat;
+        fwrite(&r,sizeof r,1,f);
+    }
+    for (size_t k=0;k<skips.n;k++) {
+        if (tl_lookup(l,skips.v[k].id)<0) continue;
+        StoreSkip r;
+        memset(&r,0,sizeof r);
+        r.id=skips.v[k].id;
+        r.due=skips.v[k].due;
+        fwrite(&r,sizeof r,1,f);
+    }
+    fwrite(blob.data,1,blob.len,f);
+    str_free(&blob);
+    if (!publish_file(f,tmp,path)) return false;
+    if(verbose) printf("Saved %s\n", path);
+    return true;
+}
+
+static bool load_file(const char *path, TaskList *out, int *io_nextId) {
+    return store_binary ? load_file_bin(path,out,io_nextId)
+                        : load_file_text(path,out,io_nextId);
+}
+
+static bool save_file(const char *path, const TaskList *h, bool verbose){
+    return store_binary ? save_file_bin(path,h,verbose)
+                        : save_file_text(path,h,verbose);
+}
+
+// The journal holds mutations made since the last snapshot, one line each:
+//   A <id> <due> <desc>   task added to the active list
+//   D <id>                task moved from active to removed
+//   S <id> <due>          one occurrence of recurring task <id> deleted
+//   R <id>                task moved from removed back to active
+// An add of a recurring task writes <due>/<rule>, as the snapshot does.
+// add/delete append a record instead of rewriting both files, and the
+// snapshot is rewritten only when the journal outgrows it (or on `save`).
+
+static off_t file_size(const char *path){
+    struct stat st;
+    return stat(path,&st)==0 ? st.st_size : 0;
+}
+
+// Caller holds the store lock; store_end() makes the append durable.
+static bool journal_write(const char *rec, size_t len){
+    int fd=open(journal_file, O_WRONLY|O_APPEND|O_CREAT, 0644);
+    if(fd<0){perror("open journal"); return false;}
+    ssize_t w=write(fd,rec,len);
+    struct stat st;
+    if (w==(ssize_t)len && fstat(fd,&st)==0) journal_end=st.st_size;
+    close(fd);
+    if(w!=(ssize_t)len){perror("write journal"); return false;}
+    return true;
+}
+
+// Needs t->len + JOURNAL_ADD_EXTRA bytes.
+#define JOURNAL_ADD_EXTRA 48
+
+static int journal_format_add(char *rec, size_t L, const Task *t){
+    char when[48];
+    fmt_due_rule(t,when,sizeof when);
+    int n=snprintf(rec,L,"A %d %s %s\n",t->id,when,task_desc(t));
+    return (n<0 || (size_t)n>=L) ? -1 : n;
+}
+
+static int journal_format_delete(char *rec, size_t L, int id){
+    return snprintf(rec,L,"D %d\n",id);
+}
+
+static int journal_format_skip(char *rec, size_t L, int id, time_t due){
+    return snprintf(rec,L,"S %d %lld\n",id,(long long)due);
+}
+
+static int journal_format_restore(char *rec, size_t L, int id){
+    return snprintf(rec,L,"R %d\n",id);
+}
+
+static bool journal_add(const Task *t){
+    size_t L=(size_t)t->len + JOURNAL_ADD_EXTRA;
+    char *rec=(char*)malloc(L);
+    if(!rec){perror("malloc"); exit(1);}
+    int n=journal_format_add(rec,L,t);
+    bool ok = n>=0 && journal_write(rec,(size_t)n);
+    free(rec);
+    return ok;
+}
+
+static bool journal_delete(int id){
+    char rec[32];
+    int n=journal_format_delete(rec,sizeof rec,id);
+    return journal_write(rec,(size_t)n);
+}
+
+static void trash_need(void);
+
+// Applies records past journal_applied, which is 0 right after the
+// snapshots are loaded. Ids only grow, so an add below the snapshot's
+// nextId was already folded in by a compaction that did not get to
+// truncate the journal; a delete of an id no longer active is likewise
+// already applied, and so is a restore of one that is. Replay is
+// therefore idempotent. A trailing record without its newline is still
+// being written and is left for next time.
+static void journal_replay(void){
+    FILE *f=fopen(journal_file,"r");
+    if(!f) return;
+    if (journal_applied && fseeko(f,journal_applied,SEEK_SET)!=0) {
+        fclose(f);
+        return;
+    }
+    int snap_next=nextId;
+    char *line=NULL;
+    size_t cap=0;
+    ssize_t n;
+    while ((n=getline(&line,&cap,f)) > 0) {
+        if (line[n-1]!='\n') break;
+        journal_applied=ftello(f);
+        if (line[0]=='A') {
+            Task t;
+            const char *desc;
+            if (!parse_task_line(line+1, line+n-1, &t, &desc)) continue;
+            if (t.id < snap_next || t.id <= 0 || tl_find(&tasks,t.id)) continue;
+            t.desc=str_load(&strs,desc,t.len);
+            tl_push(&tasks,t);
+            if (t.id >= nextId) nextId = t.id + 1;
+        } else if (line[0]=='D') {
+            int id=0;
+            if (sscanf(line+1,"%d",&id) != 1) continue;
+            Task t;
+            if (tl_remove(&tasks,id,&t)) tl_push(&trash,t);
+        } else if (line[0]=='S') {
+            int id=0;
+            long long due=0;
+            if (sscanf(line+1,"%d %lld",&id,&due) == 2) skip_add(id,(time_t)due);
+        } else if (line[0]=='R') {
+            int id=0;
+            if (sscanf(line+1,"%d",&id) != 1 || tl_find(&tasks,id)) continue;
+            Task t;
+            if (!tl_remove(&trash,id,&t)) {
+                trash_need();
+                if (!tl_remove(&trash,id,&t)) continue;
+            }
+            tl_push(&tasks,t);
+        }
+    }
+    free(line);
+    fclose(f);
+}
+
+// Removed history. `removed_file` is the head segment: the newest
+// removals, kept small by sealing it into numbered segment files
+// (<removed>.000001, ...) once it holds CLITASK_ARCHIVE_SEGMENT tasks or
+// spans a calendar month. <removed>.segments lists the sealed segments
+// with their time range, count and id range, plus the head's size and the
+// persisted nextId, so startup reads neither the head nor the segments.
+// `trash` starts out holding only removals replayed from the journal;
+// trash_need() loads the head underneath them when a command needs it.
+
+typedef struct {
+    unsigned seq;
+    time_t   first, last;    // when its tasks were archived
+    size_t   count;
+    int      min_id, max_id;
+} Segment;
+
+typedef struct {
+    Segment *segs;           // oldest first
+    size_t   n, cap;
+    time_t   head_first;     // first archive time of the head, 0 = empty
+    size_t   head_count;
+    int      next_id;
+    bool     present;        // the .segments file exists
+} Archive;
+
+static Archive archive;
+
+static bool trash_loaded = false;
+
+static void segment_path(unsigned seq, char *out, size_t L){
+    snprintf(out, L, "%s.%06u", removed_file, seq);
+}
+
+static void archive_push(const Segment *s){
+    if (archive.n == archive.cap) {
+        archive.cap = archive.cap ? archive.cap*2 : 16;
+        Segment *p=(Segment*)realloc(archive.segs, archive.cap * sizeof *p);
+        if(!p){perror("realloc"); exit(1);}
+        archive.segs=p;
+    }
+    archive.segs[archive.n++]=*s;
+}
+
+static void archive_load_index(void){
+    archive.n=0;
+    archive.head_first=0;
+    archive.head_count=0;
+    archive.next_id=1;
+    archive.present=false;
+    FILE *f=fopen(archive_file,"r");
+    if (!f) return;
+    archive.present=true;
+    char line[256];
+    while (fgets(line,sizeof line,f)) {
+        long long a=0, b=0;
+        unsigned long long cnt=0;
+        int x=0, y=0;
+        unsigned seq=0;
+        if (sscanf(line,"next %d",&x)==1) archive.next_id=x;
+        else if (sscanf(line,"head %lld %llu",&a,&cnt)==2) {
+            archive.head_first=(time_t)a;
+            archive.head_count=(size_t)cnt;
+        } else if (sscanf(line,"seg %u %lld %lld %llu %d %d",&seq,&a,&b,&cnt,&x,&y)==6) {
+            Segment s={seq,(time_t)a,(time_t)b,(size_t)cnt,x,y};
+            archive_push(&s);
+        }
+    }
+    fclose(f);
+}
+
+static bool archive_save_index(void){
+    char tmp[560];
+    snprintf(tmp,sizeof tmp,"%s.tmp",archive_file);
+    FILE *f=fopen(tmp,"w");
+    if(!f){perror("open for write"); return false;}
+    fprintf(f,"next %d\n",nextId);
+    fprintf(f,"head %lld %zu\n",(long long)archive.head_first,trash.live);
+    for (size_t i=0;i<archive.n;i++) {
+        const Segment *s=&archive.segs[i];
+        fprintf(f,"seg %u %lld %lld %zu %d %d\n", s->seq, (long long)s->first,
+                (long long)s->last, s->count, s->min_id, s->max_id);
+    }
+    if (!publish_file(f,tmp,archive_file)) return false;
+    archive.present=true;
+    archive.head_count=trash.live;
+    archive.next_id=nextId;
+    return true;
+}
+
+// Loads the head segment beneath removals already in `trash`.
+static void trash_need(void){
+    if (trash_loaded) return;
+    TaskList pending=trash;
+    memset(&trash,0,sizeof trash);
+    if (!load_file(removed_file,&trash,&nextId)) store_bad=true;
+    for (size_t i=0;i<pending.len;i++)
+        if (pending.recs[i].id) tl_push(&trash,pending.recs[i]);
+    tl_free(&pending);
+    trash_loaded=true;
+}
+
+static bool archive_load_segment(const Segment *s, TaskList *out){
+    char path[540];
+    segment_path(s->seq,path,sizeof path);
+    int ignored=1;
+    return load_file(path,out,&ignored);
+}
+
+// Every removed task, in memory or not.
+static size_t removed_total(void){
+    size_t n = trash_loaded ? trash.live : archive.head_count + trash.live;
+    for (size_t i=0;i<archive.n;i++) n+=archive.segs[i].count;
+    return n;
+}
+
+static bool same_month(time_t a, time_t b){
+    struct tm ta, tb;
+    localtime_r(&a,&ta);
+    localtime_r(&b,&tb);
+    return ta.tm_year==tb.tm_year && ta.tm_mon==tb.tm_mon;
+}
+
+// Moves the head into a new sealed segment when it is full or a month old.
+static bool archive_maybe_seal(void){
+    time_t now=time(NULL);
+    size_t limit=env_limit("CLITASK_ARCHIVE_SEGMENT", 10000);
+    if (!trash.live) return true;
+    if (trash.live < limit && (!archive.head_first || same_month(archive.head_first,now)))
+        return true;
+    Segment s;
+    memset(&s,0,sizeof s);
+    s.seq = archive.n ? archive.segs[archive.n-1].seq + 1 : 1;
+    s.first = archive.head_first ? archive.head_first : now;
+    s.last = now;
+    s.count = trash.live;
+    s.min_id = INT32_MAX;
+    for (size_t i=0;i<trash.len;i++) {
+        int id=trash.recs[i].id;
+        if (!id) continue;
+        if (id < s.min_id) s.min_id=id;
+        if (id > s.max_id) s.max_id=id;
+    }
+    char path[540];
+    segment_path(s.seq,path,sizeof path);
+    if (!save_file(path,&trash,false)) return false;
+    archive_push(&s);
+    tl_free(&trash);
+    archive.head_first=0;
+    return true;
+}
+
+static bool store_compact(bool verbose){
+    trash_need();
+    if (store_bad) return false;
+    if (!save_file(active_file, &tasks, verbose)) return false;
+    if (!archive_maybe_seal()) return false;
+    if (trash.live && !archive.head_first) archive.head_first=time(NULL);
+    // Index before head: a crash in between duplicates sealed tasks
+    // rather than losing them.
+    if (!archive_save_index()) return false;
+    if (!save_file(removed_file, &trash, verbose)) return false;
+    // The snapshots are durable now; the sync lock keeps a concurrent
+    // group commit from recording a pre-truncation offset afterwards.
+    bool sync_locked = lock_fd >= 0 && lock_range(LOCK_SYNC, F_WRLCK);
+    int rc=truncate(journal_file,0);
+    if (sync_locked) {
+        set_synced_mark(0);
+        lock_range(LOCK_SYNC, F_UNLCK);
+    }
+    if (rc<0 && errno!=ENOENT) {
+        perror("truncate journal");
+        return false;
+    }
+    journal_applied=0;
+    journal_end=0;
+    return true;
+}
+
+// Compact once the journal is both over CLITASK_JOURNAL_MAX bytes and
+// larger than half the snapshot, so rewrites stay amortised O(1) per
+// mutation however large the lists get.
+static void store_maybe_compact(void){
+    off_t j=file_size(journal_file);
+    off_t limit=(off_t)env_limit("CLITASK_JOURNAL_MAX", 64*1024);
+    off_t snap=(file_size(active_file)+file_size(removed_file))/2;
+    if (j > limit && j > snap) store_compact(false);
+}
+
+// Active list, archive index and journal; the removed head stays on disk
+// until trash_need(). Without a .segments file (older stores) the head is
+// read right away, since nextId has to account for its ids. A snapshot
+// that exists but does not load sets store_bad, and writers then refuse
+// to run rather than save what little was read over it.
+static bool load_all(void){
+    store_bad=false;
+    if (!load_file(active_file, &tasks, &nextId)) store_bad=true;
+    archive_load_index();
+    if (!archive.present) trash_need();
+    else if (archive.next_id > nextId) nextId = archive.next_id;
+    journal_replay();
+    if (!strs.kept) strs.kept=strs.len;
+    return !store_bad;
+}
+
+// Under a shared lock, so a compaction is not seen half done.
+static void reload_all_from_disk(void){
+    store_lock(F_RDLCK);
+    tl_free(&tasks);
+    tl_free(&trash);
+    skips.n = 0;
+    trash_loaded = false;
+    nextId = 1;
+    journal_applied = 0;
+    load_all();
+    store_unlock();
+}
+
+// ---------- Metrics ----------
+
+// Counters and per-phase latency histograms for serve and watch. A
+// histogram has power-of-two microsecond buckets (1us .. ~16.8s, then
+// +Inf), so recording is a clock read, a short loop and three adds.
+
+enum { PH_REQUEST, PH_RELOAD, PH_REPLAY, PH_SORT, PH_RENDER, PH_WRITE,
+       PH_NOTIFY, PH_COUNT };
+
+static const char *const phase_names[PH_COUNT]={
+    "request", "reload", "replay", "sort", "render", "write", "notify"
+};
+
+#define HIST_BUCKETS 26
+
+typedef struct {
+    uint64_t buckets[HIST_BUCKETS];  // [b] counts values <= 2^b us; last is +Inf
+    uint64_t count;
+    double   sum;
+} Histogram;
+
+static struct {
+    uint64_t  requests;
+    uint64_t  bytes_written;
+    uint64_t  connections;
+    uint64_t  reloads;
+    uint64_t  replays;
+    uint64_t  notifications;
+    uint64_t  notify_failures;
+    uint64_t  notify_timeouts;
+    uint64_t  writes;
+    uint64_t  write_batches;
+    time_t    started;
+    Histogram phase[PH_COUNT];
+} metrics;
+
+static void hist_observe(Histogram *h, double secs){
+    double us=secs*1e6;
+    size_t b=0;
+    while (b < HIST_BUCKETS-1 && (double)(1ull<<b) < us) b++;
+    h->buckets[b]++;
+    h->count++;
+    h->sum+=secs;
+}
+
+static void hist_merge(Histogram *into, const Histogram *h){
+    for (size_t b=0;b<HIST_BUCKETS;b++) into->buckets[b]+=h->buckets[b];
+    into->count+=h->count;
+    into->sum+=h->sum;
+}
+
+static void metric_observe(int phase, double secs){
+    hist_observe(&metrics.phase[phase], secs);
+}
+
+// ---------- Change detection ----------
+
+// serve and watch call store_refresh() instead of reloading blindly. On
+// Linux an inotify watch on the store directories says whether anything
+// was touched at all; the stamps below then decide between replaying only
+// the journal tail and a full reload. Without inotify the stamps are
+// checked on every call, which still costs three stats, not a parse.
+// Events are counted per watch, and each list remembers the counts it
+// has caught up with, so lists sharing one inotify fd never consume each
+// other's changes.
+
+typedef struct {
+    dev_t  dev;
+    ino_t  ino;
+    off_t  size;
+    time_t mtime;
+    long   mtime_ns;
+} FileStamp;
+
+static FileStamp stamp_active, stamp_removed, stamp_journal;
+static int change_fd = -1;      // inotify fd, readable when files change
+static uint32_t *wd_events;     // events seen per watch descriptor
+static size_t wd_cap;
+static int change_wd[3] = {-1, -1, -1};   // this list's watches
+static uint32_t change_seen[3];
+
+static FileStamp file_stamp(const char *path){
+    FileStamp fs;
+    memset(&fs,0,sizeof fs);
+    struct stat st;
+    if (stat(path,&st)!=0) return fs;
+    fs.dev=st.st_dev;
+    fs.ino=st.st_ino;
+    fs.size=st.st_size;
+    fs.mtime=st.st_mtime;
+#ifdef __linux__
+    fs.mtime_ns=st.st_mtim.tv_nsec;
+#endif
+    return fs;
+}
+
+static bool stamp_equal(const FileStamp *a, const FileStamp *b){
+    return a->dev==b->dev && a->ino==b->ino && a->size==b->size &&
+           a->mtime==b->mtime && a->mtime_ns==b->mtime_ns;
+}
+
+static void stamp_all(void){
+    stamp_active=file_stamp(active_file);
+    stamp_removed=file_stamp(removed_file);
+    stamp_journal=file_stamp(journal_file);
+}
+
+// Returns the watch descriptor, or -1.
+static int watch_dir_of(const char *path, uint32_t *seen){
+#ifdef __linux__
+    char dir[512];
+    const char *slash=strrchr(path,'/');
+    if (!slash) strcpy(dir,".");
+    else if (slash==path) strcpy(dir,"/");
+    else snprintf(dir,sizeof dir,"%.*s",(int)(slash-path),path);
+    int wd=inotify_add_watch(change_fd, dir,
+                             IN_MODIFY|IN_CLOSE_WRITE|IN_CREATE|IN_DELETE|
+                             IN_MOVED_TO|IN_MOVED_FROM|IN_ATTRIB);
+    if (wd < 0) return -1;
+    if ((size_t)wd >= wd_cap) {
+        size_t cap=wd_cap ? wd_cap : 64;
+        while (cap <= (size_t)wd) cap*=2;
+        uint32_t *p=(uint32_t*)realloc(wd_events, cap * sizeof *p);
+        if(!p){perror("realloc"); exit(1);}
+        memset(p+wd_cap, 0, (cap-wd_cap) * sizeof *p);
+        wd_events=p;
+        wd_cap=cap;
+    }
+    *seen=wd_events[wd];
+    return wd;
+#else
+    (void)path; (void)seen;
+    return -1;
+#endif
+}
+
+// Watches the current list's files; called before its stamps are taken.
+static void change_watch_files(void){
+    if (change_fd<0) return;
+    change_wd[0]=watch_dir_of(active_file, &change_seen[0]);
+    change_wd[1]=watch_dir_of(removed_file, &change_seen[1]);
+    change_wd[2]=watch_dir_of(journal_file, &change_seen[2]);
+}
+
+// The stamps of the list loaded by main() predate this; an edit in
+// between shows up as a stamp mismatch on the first refresh anyway.
+static void change_watch_init(void){
+#ifdef __linux__
+    if (change_fd<0) change_fd=inotify_init1(IN_NONBLOCK|IN_CLOEXEC);
+#endif
+    change_watch_files();
+}
+
+// Counts pending inotify events against their watches.
+static void change_drain(void){
+#ifdef __linux__
+    if (change_fd<0) return;
+    union { struct inotify_event ev; char raw[4096]; } buf;
+    for (;;) {
+        ssize_t n=read(change_fd,buf.raw,sizeof buf.raw);
+        if (n<=0) break;
+        for (ssize_t off=0; off<n; ) {
+            const struct inotify_event *ev=(const struct inotify_event*)(void*)(buf.raw+off);
+            if (ev->wd >= 0 && (size_t)ev->wd < wd_cap) wd_events[ev->wd]++;
+            else if (ev->mask & IN_Q_OVERFLOW)
+                for (size_t i=0;i<wd_cap;i++) wd_events[i]++;
+            off += (ssize_t)(sizeof *ev + ev->len);
+        }
+    }
+#endif
+}
+
+// True if a watch has seen events since *seen, which is brought up to date.
+static bool change_since(int wd, uint32_t *seen){
+    if (wd<0) return true;
+    if (wd_events[wd]==*seen) return false;
+    *seen=wd_events[wd];
+    return true;
+}
+
+// True if the current list's files may have changed.
+static bool change_pending(void){
+    if (change_fd<0) return true;
+    change_drain();
+    bool any=false;
+    for (int k=0;k<3;k++)
+        if (change_since(change_wd[k], &change_seen[k])) any=true;
+    return any;
+}
+
+// Brings memory up to date with disk. Returns true if anything changed.
+static bool store_refresh(void){
+    if (!change_pending()) return false;
+    FileStamp a=file_stamp(active_file);
+    FileStamp r=file_stamp(removed_file);
+    FileStamp j=file_stamp(journal_file);
+    if (stamp_equal(&a,&stamp_active) && stamp_equal(&r,&stamp_removed) &&
+        stamp_equal(&j,&stamp_journal))
+        return false;
+    bool snapshots_same = stamp_equal(&a,&stamp_active) &&
+                          stamp_equal(&r,&stamp_removed);
+    bool journal_appended = j.dev==stamp_journal.dev &&
+                            j.ino==stamp_journal.ino &&
+                            j.size>=journal_applied;
+    double t0=mono_seconds();
+    if (snapshots_same && journal_appended) {
+        journal_replay();
+        metrics.replays++;
+        metric_observe(PH_REPLAY, mono_seconds()-t0);
+    } else {
+        reload_all_from_disk();
+        metrics.reloads++;
+        metric_observe(PH_RELOAD, mono_seconds()-t0);
+    }
+    stamp_active=a;
+    stamp_removed=r;
+    stamp_journal=j;
+    store_generation++;
+    return true;
+}
+
+// Brackets a command that writes: takes the store lock and catches up
+// with other writers first, so ids and deletes apply to the latest state.
+// False, with the lock released, if the store could not be read.
+static bool store_begin(void){
+    store_lock(F_WRLCK);
+    store_refresh();
+    if (!store_bad) return true;
+    store_unlock();
+    fprintf(stderr,"%s: store could not be read; not writing to it.\n", active_file);
+    return false;
+}
+
+// Everything on disk since store_begin() is ours: adopt it without a
+// reload, release the lock, then wait for the group commit.
+static void store_end(void){
+    stamp_all();
+    journal_applied=stamp_journal.size;
+    store_generation++;
+    off_t end=journal_end;
+    journal_end=0;
+    store_unlock();
+    if (end) journal_commit(end);
+}
+
+// ---------- Output buffers ----------
+
+// Growable byte buffer that listings and HTTP responses are rendered into,
+// then handed to the kernel in as few writes as possible.
+typedef struct {
+    char  *data;
+    size_t len;
+    size_t cap;
+} OutBuf;
+
+static void ob_reserve(OutBuf *b, size_t extra){
+    if (b->len + extra <= b->cap) return;
+    size_t cap=b->cap ? b->cap : 4096;
+    while (cap < b->len + extra) cap*=2;
+    char *p=(char*)realloc(b->data,cap);
+    if(!p){perror("realloc"); exit(1);}
+    b->data=p;
+    b->cap=cap;
+}
+
+static void ob_put(OutBuf *b, const void *p, size_t n){
+    ob_reserve(b,n);
+    memcpy(b->data + b->len, p, n);
+    b->len+=n;
+}
+
+static void ob_puts(OutBuf *b, const char *s){
+    ob_put(b,s,strlen(s));
+}
+
+static void ob_putc(OutBuf *b, char c){
+    ob_reserve(b,1);
+    b->data[b->len++]=c;
+}
+
+static void ob_printf(OutBuf *b, const char *fmt, ...){
+    va_list ap;
+    va_start(ap,fmt);
+    int n=vsnprintf(b->data ? b->data + b->len : NULL,
+                    b->cap - b->len, fmt, ap);
+    va_end(ap);
+    if (n<0) return;
+    if ((size_t)n >= b->cap - b->len) {
+        ob_reserve(b,(size_t)n + 1);
+        va_start(ap,fmt);
+        vsnprintf(b->data + b->len, b->cap - b->len, fmt, ap);
+        va_end(ap);
+    }
+    b->len+=(size_t)n;
+}
+
+// Left-justified in `width` columns like "%-*s".
+static void ob_pad(OutBuf *b, const char *s, size_t width){
+    size_t n=strlen(s);
+    ob_put(b,s,n);
+    if (n < width) {
+        ob_reserve(b,width-n);
+        memset(b->data + b->len, ' ', width-n);
+        b->len+=width-n;
+    }
+}
+
+static void ob_int(OutBuf *b, long long v){
+    char tmp[24];
+    char *p=tmp+sizeof tmp;
+    unsigned long long u = v<0 ? 0ull-(unsigned long long)v : (unsigned long long)v;
+    do { *--p=(char)('0' + u%10); u/=10; } while (u);
+    if (v<0) *--p='-';
+    ob_put(b,p,(size_t)(tmp+sizeof tmp - p));
+}
+
+// Bytes that need escaping inside a JSON string.
+static bool json_escape_byte(unsigned char c){
+    return c < 0x20 || c=='"' || c=='\\' || c==0x7f;
+}
+
+// Copies runs of plain bytes in one go; quotes, backslashes and control
+// characters become their JSON escapes. Non-ASCII passes through as UTF-8.
+static void ob_json_str(OutBuf *b, const char *s){
+    static const char hex[]="0123456789abcdef";
+    for (;;) {
+        const char *run=s;
+        while (*s && !json_escape_byte((unsigned char)*s)) s++;
+        if (s>run) ob_put(b,run,(size_t)(s-run));
+        if (!*s) return;
+        unsigned char c=(unsigned char)*s++;
+        char esc[6]={'\\',0,0,0,0,0};
+        size_t n=2;
+        switch (c) {
+        case '"':  esc[1]='"';  break;
+        case '\\': esc[1]='\\'; break;
+        case '\b': esc[1]='b';  break;
+        case '\f': esc[1]='f';  break;
+        case '\n': esc[1]='n';  break;
+        case '\r': esc[1]='r';  break;
+        case '\t': esc[1]='t';  break;
+        default:
+            esc[1]='u'; esc[2]='0'; esc[3]='0';
+            esc[4]=hex[c>>4]; esc[5]=hex[c&15];
+            n=6;
+        }
+        ob_put(b,esc,n);
+    }
+}
+
+// Writes all of iov to a blocking fd, coalescing into one writev where
+// the kernel takes it all.
+static bool write_iov(int fd, struct iovec *iov, int cnt){
+    while (cnt > 0) {
+        ssize_t w=writev(fd,iov,cnt);
+        if (w<0) {
+            if (errno==EINTR) continue;
+            return false;
+        }
+        size_t left=(size_t)w;
+        while (cnt > 0 && left >= iov->iov_len) {
+            left-=iov->iov_len;
+            iov++;
+            cnt--;
+        }
+        if (cnt > 0) {
+            iov->iov_base=(char*)iov->iov_base + left;
+            iov->iov_len-=left;
+        }
+    }
+    return true;
+}
+
+static bool ob_flush_fd(OutBuf *b, int fd){
+    struct iovec iov;
+    iov.iov_base=b->data;
+    iov.iov_len=b->len;
+    bool ok=write_iov(fd,&iov,1);
+    b->len=0;
+    return ok;
+}
+
+static void ob_free(OutBuf *b){
+    free(b->data);
+    memset(b,0,sizeof *b);
+}
+
+static void print_welcome_header(void){
+    const char *B=S_BOLD(), *R=S_RESET(), *BL=C_BLUE();
+    printf("%s%s========================================%s\n", BL,B,R);
+    printf("%s TODO LIST%s\n", B,R);
+    printf("%s========================================%s\n", BL,B?R:"");
+    time_t now=time(NULL);
+    char buf[64];
+    struct tm tm;
+    localtime_r(&now,&tm);
+    strftime(buf,sizeof buf,"%A, %Y-%m-%d %H:%M",&tm);
+    printf("Now: %s\n", buf);
+    printf("Active: %s\n", active_file);
+    printf("Removed: %s\n\n", removed_file);
+}
+
+static int cmp_task_ptrs(const void *a,const void *b){
+    const Task *ta=*(const Task * const *)a, *tb=*(const Task * const *)b;
+    if (ta->due==0 && tb->due==0) return ta->id - tb->id;
+    if (ta->due==0) return 1;
+    if (tb->due==0) return -1;
+    if (ta->due < tb->due) return -1;
+    if (ta->due > tb->due) return 1;
+    return ta->id - tb->id;
+}
+
+// Same layout as "%-16s %-3d %s\n". `days` may be NULL.
+static void print_task_row(OutBuf *out, DayFmt *days, const Task *t){
+    char when[32];
+    fmt_when_day(days, t->due, when, sizeof when);
+    ob_pad(out, when, 16);
+    ob_putc(out, ' ');
+    size_t mark=out->len;
+    ob_int(out, t->id);
+    while (out->len - mark < 3) ob_putc(out, ' ');
+    ob_putc(out, ' ');
+    ob_put(out, task_desc(t), t->len);
+    if (t->repeat) {
+        char rule[16];
+        repeat_name(t->repeat, rule, sizeof rule);
+        ob_printf(out, " (repeats %s)", rule);
+    }
+    ob_putc(out, '\n');
+}
+
+static void print_table_head(OutBuf *out){
+    ob_puts(out, "Due              ID  Description\n"
+                 "---------------- --- ------------------------------\n");
+}
+
+// ---------- Search index ----------
+
+// Inverted index over descriptions of active and removed tasks, kept in
+// <active>.idx (CLITASK_INDEX). Postings hold task ids, and a task keeps
+// its id when it moves to the removed list, so deletes never touch the
+// index. Each writer appends the terms of the tasks it adds to the end of
+// the file (the delta) while it holds the store lock. Ids reach the
+// delta in order, so one missing below nextId means an append was lost,
+// and the file is rebuilt. It is also rebuilt once the delta holds more
+// than SEARCH_DELTA_MAX tasks.
+
+#define TERM_MAX 32
+#define SEARCH_DELTA_MAX 1024
+#define INDEX_VERSION 2u
+
+typedef struct {
+    char     magic[8];       // "CLTIDX\0\0"
+    uint32_t version;        // INDEX_VERSION
+    uint32_t nterms;
+    int32_t  max_id;         // every id up to here is in the image
+    uint32_t count;          // tasks with id <= max_id when written
+    uint64_t npost;
+    uint64_t text_len;
+} IndexHeader;
+
+typedef struct {
+    uint32_t text_off;       // NUL-terminated term
+    uint32_t post_off;       // ascending ids
+    uint32_t post_cnt;
+    uint32_t reserved;
+} IndexTerm;
+
+typedef struct {
+    uint32_t term;
+    int32_t  id;
+} TermPost;
+
+// One task in the delta, followed by its terms, each NUL-terminated.
+// Records follow the image unaligned.
+typedef struct {
+    int32_t  id;
+    uint32_t len;            // bytes of terms
+} DeltaRecord;
+
+// Interned terms plus (term, id) pairs, in the order tasks were added.
+typedef struct {
+    char     *text;
+    size_t    text_len, text_cap;
+    uint32_t *off;
+    uint32_t  nterms, off_cap;
+    uint32_t *slots;         // term+1, 0 = empty
+    uint32_t  slot_cap;
+    TermPost *pairs;
+    size_t    npairs, pairs_cap;
+    size_t    ntasks;
+} TermTable;
+
+typedef struct {
+    char              *image;      // file contents, mapped or malloc'd
+    size_t             image_len;
+    bool               mapped;
+    const IndexHeader *hdr;
+    const IndexTerm   *terms;
+    const int32_t     *post;
+    const char        *text;
+    const char        *delta;      // DeltaRecords past the image
+    size_t             delta_len;
+    size_t             delta_n;
+    int                top;        // every id up to here is covered
+    FileStamp          stamp;
+    unsigned long      generation;
+} SearchIndex;
+
+static SearchIndex search_idx;
+
+static bool term_byte(unsigned char c){
+    return isalnum(c) || c >= 0x80;
+}
+
+// Next term of *p: a run of letters, digits or non-ASCII bytes, folded to
+// lower case like lcase() and cut at TERM_MAX bytes. Returns its length,
+// 0 at the end of the string.
+static size_t next_term(const char **p, char *out){
+    const unsigned char *s=(const unsigned char*)*p;
+    while (*s && !term_byte(*s)) s++;
+    size_t n=0;
+    for (; *s && term_byte(*s); s++)
+        if (n < TERM_MAX) out[n++]=(char)tolower(*s);
+    out[n]='\0';
+    *p=(const char*)s;
+    return n;
+}
+
+static void tt_free(TermTable *tt){
+    free(tt->text);
+    free(tt->off);
+    free(tt->slots);
+    free(tt->pairs);
+    memset(tt,0,sizeof *tt);
+}
+
+static void tt_rehash(TermTable *tt){
+    uint32_t cap = tt->slot_cap ? tt->slot_cap*2 : 1024;
+    uint32_t *s=(uint32_t*)calloc(cap,sizeof *s);
+    if(!s){perror("calloc"); exit(1);}
+    for (uint32_t t=0;t<tt->nterms;t++) {
+        const char *w=tt->text + tt->off[t];
+        size_t i=(size_t)fnv1a(w,strlen(w)) & (cap-1);
+        while (s[i]) i=(i+1) & (cap-1);
+        s[i]=t+1;
+    }
+    free(tt->slots);
+    tt->slots=s;
+    tt->slot_cap=cap;
+}
+
+// Term number of w, or -1. With `add`, unknown terms are interned.
+static long tt_term(TermTable *tt, const char *w, size_t n, bool add){
+    if (add && (tt->nterms+1)*2 > tt->slot_cap) tt_rehash(tt);
+    if (!tt->slot_cap) return -1;
+    size_t mask=tt->slot_cap-1;
+    size_t i=(size_t)fnv1a(w,n) & mask;
+    for (; tt->slots[i]; i=(i+1) & mask) {
+        const char *s=tt->text + tt->off[tt->slots[i]-1];
+        if (memcmp(s,w,n)==0 && s[n]=='\0') return tt->slots[i]-1;
+    }
+    if (!add) return -1;
+    if (tt->text_len + n + 1 > tt->text_cap) {
+        size_t cap = tt->text_cap ? tt->text_cap*2 : 4096;
+        while (cap < tt->text_len + n + 1) cap*=2;
+        char *p=(char*)realloc(tt->text,cap);
+        if(!p){perror("realloc"); exit(1);}
+        tt->text=p;
+        tt->text_cap=cap;
+    }
+    if (tt->nterms == tt->off_cap) {
+        tt->off_cap = tt->off_cap ? tt->off_cap*2 : 512;
+        uint32_t *p=(uint32_t*)realloc(tt->off, tt->off_cap * sizeof *p);
+        if(!p){perror("realloc"); exit(1);}
+        tt->off=p;
+    }
+    tt->off[tt->nterms]=(uint32_t)tt->text_len;
+    memcpy(tt->text + tt->text_len, w, n);
+    tt->text[tt->text_len + n]='\0';
+    tt->text_len+=n+1;
+    tt->slots[i]=tt->nterms+1;
+    return tt->nterms++;
+}
+
+static void tt_add_task(TermTable *tt, const Task *t){
+    char w[TERM_MAX+1];
+    const char *p=task_desc(t);
+    size_t n;
+    while ((n=next_term(&p,w))) {
+        if (tt->npairs == tt->pairs_cap) {
+            tt->pairs_cap = tt->pairs_cap ? tt->pairs_cap*2 : 1024;
+            TermPost *q=(TermPost*)realloc(tt->pairs, tt->pairs_cap * sizeof *q);
+            if(!q){perror("realloc"); exit(1);}
+            tt->pairs=q;
+        }
+        tt->pairs[tt->npairs].term=(uint32_t)tt_term(tt,w,n,true);
+        tt->pairs[tt->npairs].id=t->id;
+        tt->npairs++;
+    }
+    tt->ntasks++;
+}
+
+// Adds the tasks of l; raises *max_id.
+static void tt_add_list(TermTable *tt, const TaskList *l, int *max_id){
+    for (size_t i=0;i<l->len;i++) {
+        const Task *t=&l->recs[i];
+        if (!t->id) continue;
+        tt_add_task(tt,t);
+        if (t->id > *max_id) *max_id=t->id;
+    }
+}
+
+static int cmp_int32(const void *a, const void *b){
+    int32_t x=*(const int32_t*)a, y=*(const int32_t*)b;
+    return (x>y)-(x<y);
+}
+
+// Sorts and dedupes ids[0..n) in place; returns the new length.
+static size_t sort_unique(int32_t *ids, size_t n){
+    bool sorted=true;
+    for (size_t i=1;i<n && sorted;i++) sorted = ids[i-1] <= ids[i];
+    if (!sorted) qsort(ids,n,sizeof *ids,cmp_int32);
+    size_t w=0;
+    for (size_t i=0;i<n;i++)
+        if (!w || ids[w-1]!=ids[i]) ids[w++]=ids[i];
+    return w;
+}
+
+typedef struct {
+    const char *word;
+    uint32_t    term;
+} TermOrder;
+
+static int cmp_term_order(const void *a, const void *b){
+    return strcmp(((const TermOrder*)a)->word, ((const TermOrder*)b)->word);
+}
+
+// Tokenizes every task and lays the result out in the on-disk format.
+static char *search_build(size_t *out_len){
+    TermTable tt;
+    memset(&tt,0,sizeof tt);
+    int max_id=0;
+    trash_need();
+    tt_add_list(&tt,&tasks,&max_id);
+    tt_add_list(&tt,&trash,&max_id);
+    for (size_t s=0;s<archive.n;s++) {
+        TaskList seg;
+        memset(&seg,0,sizeof seg);
+        archive_load_segment(&archive.segs[s],&seg);
+        tt_add_list(&tt,&seg,&max_id);
+        tl_free(&seg);
+    }
+    // Ids handed out but no longer anywhere are covered too.
+    if (nextId-1 > max_id) max_id=nextId-1;
+
+    // Group the pairs by term (counting sort), then sort each group.
+    size_t *start=(size_t*)calloc((size_t)tt.nterms+1,sizeof *start);
+    size_t *cnt=(size_t*)calloc((size_t)tt.nterms+1,sizeof *cnt);
+    int32_t *ids=(int32_t*)malloc((tt.npairs ? tt.npairs : 1) * sizeof *ids);
+    if(!start || !cnt || !ids){perror("malloc"); exit(1);}
+    for (size_t i=0;i<tt.npairs;i++) start[tt.pairs[i].term+1]++;
+    for (uint32_t t=0;t<tt.nterms;t++) start[t+1]+=start[t];
+    for (size_t i=0;i<tt.npairs;i++) {
+        uint32_t t=tt.pairs[i].term;
+        ids[start[t] + cnt[t]++]=tt.pairs[i].id;
+    }
+    size_t npost=0;
+    for (uint32_t t=0;t<tt.nterms;t++) {
+        size_t n=sort_unique(ids+start[t],cnt[t]);
+        memmove(ids+npost, ids+start[t], n * sizeof *ids);
+        start[t]=npost;
+        cnt[t]=n;
+        npost+=n;
+    }
+
+    TermOrder *order=(TermOrder*)malloc((tt.nterms ? tt.nterms : 1) * sizeof *order);
+    if(!order){perror("malloc"); exit(1);}
+    for (uint32_t t=0;t<tt.nterms;t++) {
+        order[t].word=tt.text + tt.off[t];
+        order[t].term=t;
+    }
+    qsort(order,tt.nterms,sizeof *order,cmp_term_order);
+
+    size_t len = sizeof(IndexHeader) + (size_t)tt.nterms * sizeof(IndexTerm) +
+                 npost * sizeof(int32_t) + tt.text_len;
+    char *img=(char*)calloc(1,len);
+    if(!img){perror("calloc"); exit(1);}
+    IndexHeader *h=(IndexHeader*)img;
+    memcpy(h->magic,"CLTIDX",7);
+    h->version=INDEX_VERSION;
+    h->nterms=tt.nterms;
+    h->max_id=max_id;
+    h->count=(uint32_t)tt.ntasks;
+    h->npost=npost;
+    h->text_len=tt.text_len;
+    IndexTerm *terms=(IndexTerm*)(h+1);
+    for (uint32_t i=0;i<tt.nterms;i++) {
+        uint32_t t=order[i].term;
+        terms[i].text_off=tt.off[t];
+        terms[i].post_off=(uint32_t)start[t];
+        terms[i].post_cnt=(uint32_t)cnt[t];
+    }
+    char *p=(char*)(terms + tt.nterms);
+    if (npost) memcpy(p, ids, npost * sizeof *ids);
+    p+=npost * sizeof *ids;
+    if (tt.text_len) memcpy(p, tt.text, tt.text_len);
+
+    free(order);
+    free(ids);
+    free(cnt);
+    free(start);
+    tt_free(&tt);
+    *out_len=len;
+    return img;
+}
+
+static void search_close(void){
+    SearchIndex *ix=&search_idx;
+    if (ix->mapped) munmap(ix->image, ix->image_len);
+    else free(ix->image);
+    memset(ix,0,sizeof *ix);
+}
+
+// Points the index at an image after checking that it is well formed.
+// The delta is read up to a torn record or a gap in the ids.
+static bool search_adopt(char *img, size_t len, bool mapped){
+    const IndexHeader *h=(const IndexHeader*)img;
+    if (len < sizeof *h || memcmp(h->magic,"CLTIDX",7)!=0 ||
+        h->version!=INDEX_VERSION)
+        return false;
+    uint64_t need = sizeof *h + (uint64_t)h->nterms * sizeof(IndexTerm) +
+                    h->npost * sizeof(int32_t) + h->text_len;
+    if (need > len) return false;
+    const IndexTerm *terms=(const IndexTerm*)(h+1);
+    const char *text=img + need - h->text_len;
+    if (h->text_len && text[h->text_len-1]) return false;
+    for (uint32_t i=0;i<h->nterms;i++)
+        if (terms[i].text_off >= h->text_len ||
+            (uint64_t)terms[i].post_off + terms[i].post_cnt > h->npost)
+            return false;
+    int top=h->max_id;
+    size_t at=(size_t)need, n=0;
+    while (len - at >= sizeof(DeltaRecord)) {
+        DeltaRecord r;
+        memcpy(&r, img + at, sizeof r);
+        const char *w=img + at + sizeof r;
+        if (r.len > len - at - sizeof r || (r.len && w[r.len-1]) || r.id > top+1)
+            break;
+        if (r.id == top+1) top++;
+        at+=sizeof r + r.len;
+        n++;
+    }
+    SearchIndex *ix=&search_idx;
+    ix->image=img;
+    ix->image_len=len;
+    ix->mapped=mapped;
+    ix->hdr=h;
+    ix->terms=terms;
+    ix->post=(const int32_t*)(terms + h->nterms);
+    ix->text=text;
+    ix->delta=img + need;
+    ix->delta_len=at - (size_t)need;
+    ix->delta_n=n;
+    ix->top=top;
+    return true;
+}
+
+static bool search_open(void){
+    int fd=open(index_file,O_RDONLY);
+    if (fd<0) return false;
+    struct stat st;
+    if (fstat(fd,&st)!=0 || st.st_size < (off_t)sizeof(IndexHeader)) {
+        close(fd);
+        return false;
+    }
+    size_t len=(size_t)st.st_size;
+    void *m=mmap(NULL,len,PROT_READ,MAP_PRIVATE,fd,0);
+    close(fd);
+    if (m==MAP_FAILED) return false;
+    if (!search_adopt((char*)m,len,true)) {
+        munmap(m,len);
+        return false;
+    }
+    search_idx.stamp=file_stamp(index_file);
+    return true;
+}
+
+// Rebuilds from the lists in memory and publishes the result with a
+// rename. A failed write still leaves a usable in-memory index.
+static void search_rebuild(void){
+    search_close();
+    size_t len=0;
+    char *img=search_build(&len);
+    char tmp[540];
+    snprintf(tmp,sizeof tmp,"%s.tmp",index_file);
+    int fd=open(tmp,O_WRONLY|O_CREAT|O_TRUNC,0644);
+    bool ok = fd>=0;
+    if (ok) {
+        struct iovec iov={img,len};
+        ok=write_iov(fd,&iov,1);
+        ok = close(fd)==0 && ok;
+        ok = ok && rename(tmp,index_file)==0;
+        if (!ok) unlink(tmp);
+    }
+    search_adopt(img,len,false);
+    if (ok) search_idx.stamp=file_stamp(index_file);
+}
+
+// Brings the index up to date with the lists in memory. Costs one stat
+// when nothing changed and a walk over the delta's record headers when
+// the file did; the lists are read only to rebuild. An index that covers
+// less than nextId lost an append, and one that covers more names tasks
+// of a store that has since been replaced.
+static void search_sync(void){
+    SearchIndex *ix=&search_idx;
+    if (ix->hdr) {
+        FileStamp now=file_stamp(index_file);
+        if (!stamp_equal(&now,&ix->stamp)) search_close();
+        else if (ix->generation==store_generation) return;
+    }
+    if (!ix->hdr && !search_open()) search_rebuild();
+    if (ix->top != nextId-1 || ix->delta_n > SEARCH_DELTA_MAX) search_rebuild();
+    ix->generation=store_generation;
+}
+
+// Appends the terms of tasks first..nextId-1, just added to the active
+// list and journaled, to the index file if there is one. Called with the
+// store locked. A batch too big for the delta, or ids the image already
+// claims, leave the file to be rebuilt by the next search instead.
+static void search_note_adds(int first){
+    if (first >= nextId) return;
+    int fd=open(index_file,O_RDWR|O_APPEND);
+    if (fd<0) return;
+    IndexHeader h;
+    if (nextId - first > SEARCH_DELTA_MAX ||
+        pread(fd,&h,sizeof h,0) != (ssize_t)sizeof h ||
+        h.version != INDEX_VERSION || h.max_id >= first) {
+        close(fd);
+        unlink(index_file);
+        return;
+    }
+    OutBuf out={0};
+    char w[TERM_MAX+1];
+    for (int id=first; id<nextId; id++) {
+        const Task *t=tl_find(&tasks,id);
+        DeltaRecord r={id, 0};
+        size_t at=out.len;
+        ob_put(&out,(const char*)&r,sizeof r);
+        const char *p = t ? task_desc(t) : "";
+        for (size_t n; (n=next_term(&p,w)); ) ob_put(&out,w,n+1);
+        r.len=(uint32_t)(out.len - at - sizeof r);
+        memcpy(out.data + at, &r, sizeof r);
+    }
+    if (!ob_flush_fd(&out,fd)) unlink(index_file);
+    close(fd);
+    ob_free(&out);
+}
+
+// Postings of one term: a slice of the image plus the (newer) delta ids.
+typedef struct {
+    const int32_t *base;
+    size_t         nbase;
+    int32_t       *delta;
+    size_t         ndelta;
+} Posting;
+
+static void search_posting(const char *w, Posting *p){
+    const SearchIndex *ix=&search_idx;
+    memset(p,0,sizeof *p);
+    size_t lo=0, hi=ix->hdr->nterms;
+    while (lo < hi) {
+        size_t mid=lo+(hi-lo)/2;
+        int c=strcmp(ix->text + ix->terms[mid].text_off, w);
+        if (c==0) {
+            p->base=ix->post + ix->terms[mid].post_off;
+            p->nbase=ix->terms[mid].post_cnt;
+            break;
+        }
+        if (c<0) lo=mid+1; else hi=mid;
+    }
+    for (size_t at=0; at < ix->delta_len; ) {
+        DeltaRecord r;
+        memcpy(&r, ix->delta + at, sizeof r);
+        const char *s=ix->delta + at + sizeof r, *end=s + r.len;
+        at+=sizeof r + r.len;
+        if (r.id <= ix->hdr->max_id) continue;
+        for (; s < end && strcmp(s,w)!=0; s+=strlen(s)+1) ;
+        if (s == end) continue;
+        if (p->ndelta % 64 == 0) {
+            int32_t *q=(int32_t*)realloc(p->delta,(p->ndelta+64) * sizeof *q);
+            if(!q){perror("realloc"); exit(1);}
+            p->delta=q;
+        }
+        p->delta[p->ndelta++]=r.id;
+    }
+    p->ndelta=sort_unique(p->delta,p->ndelta);
+}
+
+static bool ids_contain(const int32_t *ids, size_t n, int32_t id){
+    return bsearch(&id,ids,n,sizeof *ids,cmp_int32)!=NULL;
+}
+
+static bool posting_has(const Posting *p, int32_t id){
+    return ids_contain(p->base,p->nbase,id) || ids_contain(p->delta,p->ndelta,id);
+}
+
+// Copies the archived tasks among ids (ascending) into out, reading only
+// segments whose id range can hold one of them.
+static void archive_collect(const int32_t *ids, size_t n, TaskList *out){
+    for (size_t s=0;s<archive.n && n;s++) {
+        const Segment *sg=&archive.segs[s];
+        size_t lo=0, hi=n;
+        while (lo < hi) {
+            size_t mid=lo+(hi-lo)/2;
+            if (ids[mid] < sg->min_id) lo=mid+1; else hi=mid;
+        }
+        if (lo==n || ids[lo] > sg->max_id) continue;
+        TaskList seg;
+        memset(&seg,0,sizeof seg);
+        archive_load_segment(sg,&seg);
+        for (size_t i=0;i<seg.len;i++)
+            if (seg.recs[i].id && ids_contain(ids,n,seg.recs[i].id))
+                tl_push(out,seg.recs[i]);
+        tl_free(&seg);
+    }
+}
+
+// Every archived task, oldest segment first.
+static void archive_load_all(TaskList *out){
+    for (size_t s=0;s<archive.n;s++) archive_load_segment(&archive.segs[s],out);
+}
+
+// Ids of tasks whose description contains every term of `query`. The
+// shortest posting list drives; the others are probed by binary search.
+static int32_t *search_query(const char *query, size_t *out_n){
+    *out_n=0;
+    search_sync();
+    Posting *p=NULL;
+    size_t np=0, cap=0;
+    char w[TERM_MAX+1];
+    bool empty=false;
+    while (next_term(&query,w)) {
+        if (np==cap) {
+            cap = cap ? cap*2 : 8;
+            Posting *q=(Posting*)realloc(p,cap * sizeof *q);
+            if(!q){perror("realloc"); exit(1);}
+            p=q;
+        }
+        search_posting(w,&p[np]);
+        if (!p[np].nbase && !p[np].ndelta) empty=true;
+        np++;
+    }
+    int32_t *out=NULL;
+    if (np && !empty) {
+        size_t best=0;
+        for (size_t i=1;i<np;i++)
+            if (p[i].nbase + p[i].ndelta < p[best].nbase + p[best].ndelta) best=i;
+        size_t total=p[best].nbase + p[best].ndelta;
+        out=(int32_t*)malloc(total * sizeof *out);
+        if(!out){perror("malloc"); exit(1);}
+        for (size_t j=0;j<total;j++) {
+            int32_t id = j < p[best].nbase ? p[best].base[j] : p[best].delta[j-p[best].nbase];
+            bool all=true;
+            for (size_t i=0;i<np && all;i++)
+                if (i!=best) all=posting_has(&p[i],id);
+            if (all) out[(*out_n)++]=id;
+        }
+    }
+    for (size_t i=0;i<np;i++) free(p[i].delta);
+    free(p);
+    return out;
+}
+
+// ---------- Named lists ----------
+
+// Besides the default list, serve and watch host named lists, each with
+// the usual files under <lists dir>/<name>/ (CLITASK_LISTS, default
+// "lists"); CLI commands pick one with CLITASK_LIST. The code below works
+// on one set of globals: a list that is not current keeps them parked in
+// a ListState, and list_enter() swaps states, loading a list the first
+// time it is entered. serve drops the state of lists idle for
+// CLITASK_LIST_IDLE seconds, so an idle list costs its name and a
+// NamedList.
+
+// Fully rendered responses for / and /json, rebuilt only when
+// store_generation moves. `head` holds the header lines without the
+// terminating blank line, so a Connection header can be spliced in for
+// closing requests; a warm hit is a single writev of head + body.
+
+enum { VIEW_TEXT, VIEW_JSON, VIEW_COUNT };
+
+typedef struct {
+    unsigned long generation;     // 0 = never rendered
+    time_t expires;               // next midnight with recurring tasks, else 0
+    OutBuf head;
+    OutBuf body;
+    char   etag[24];
+    char   last_modified[40];
+} ViewCache;
+
+static ViewCache view_cache[VIEW_COUNT];
+
+// Occurrences already notified, keyed by occ_key(id, due) so each
+// occurrence of a recurring task gets its own reminder: an open-addressing
+// set (0 = empty slot) that grows with the number of reminders instead of
+// silently filling up, and sheds the ones already behind the scan.
+typedef struct {
+    uint64_t *slots;
+    size_t    cap;
+    size_t    len;
+} IdSet;
+
+static IdSet seen;
+
+typedef struct {
+    TaskList      tasks, trash;
+    StrArena      strs;
+    SkipSet       skips;
+    int           next_id;
+    off_t         journal_applied;
+    unsigned long generation;
+    Archive       archive;
+    bool          trash_loaded;
+    bool          bad;
+    FileStamp     stamp_active, stamp_removed, stamp_journal;
+    int           change_wd[3];
+    uint32_t      change_seen[3];
+    SearchIndex   search;
+    ViewCache     views[VIEW_COUNT];
+    IdSet         seen;
+} ListState;
+
+typedef struct {
+    char      *name;         // NULL for the default list
+    ListState *parked;       // its globals while another list is current
+    bool       loaded;
+    int        streams;      // HTTP responses still reading it
+    time_t     last_used;
+} NamedList;
+
+static NamedList default_list = {NULL, NULL, true, 0, 0};
+static NamedList *cur_list = &default_list;
+static NamedList **lists;          // named lists, in order of discovery
+static size_t n_lists, lists_cap;
+static NamedList **list_slots;     // by name, open addressing; NULL = empty
+static size_t list_slot_cap;
+
+static void list_park(void){
+    NamedList *l=cur_list;
+    if (!l->parked) {
+        l->parked=(ListState*)calloc(1,sizeof *l->parked);
+        if(!l->parked){perror("calloc"); exit(1);}
+    }
+    ListState *s=l->parked;
+    s->tasks=tasks;
+    s->trash=trash;
+    s->strs=strs;
+    s->skips=skips;
+    s->next_id=nextId;
+    s->journal_applied=journal_applied;
+    s->generation=store_generation;
+    s->archive=archive;
+    s->trash_loaded=trash_loaded;
+    s->bad=store_bad;
+    s->stamp_active=stamp_active;
+    s->stamp_removed=stamp_removed;
+    s->stamp_journal=stamp_journal;
+    memcpy(s->change_wd, change_wd, sizeof change_wd);
+    memcpy(s->change_seen, change_seen, sizeof change_seen);
+    s->search=search_idx;
+    memcpy(s->views, view_cache, sizeof view_cache);
+    s->seen=seen;
+    // Only held across a lock; one descriptor per loaded list would run
+    // a process hosting thousands of lists out of them.
+    if (lock_fd >= 0) { close(lock_fd); lock_fd=-1; }
+}
+
+static void list_unpark(const ListState *s){
+    tasks=s->tasks;
+    trash=s->trash;
+    strs=s->strs;
+    skips=s->skips;
+    nextId=s->next_id;
+    journal_applied=s->journal_applied;
+    store_generation=s->generation;
+    archive=s->archive;
+    trash_loaded=s->trash_loaded;
+    store_bad=s->bad;
+    stamp_active=s->stamp_active;
+    stamp_removed=s->stamp_removed;
+    stamp_journal=s->stamp_journal;
+    memcpy(change_wd, s->change_wd, sizeof change_wd);
+    memcpy(change_seen, s->change_seen, sizeof change_seen);
+    search_idx=s->search;
+    memcpy(view_cache, s->views, sizeof view_cache);
+    seen=s->seen;
+}
+
+static void list_set_paths(const NamedList *l){
+    if (l->name) set_list_paths(l->name);
+    else init_paths();
+}
+
+// Makes l current, loading it on first use.
+static void list_enter(NamedList *l){
+    if (l==cur_list) return;
+    list_park();
+    if (l->parked) list_unpark(l->parked);
+    else {
+        ListState fresh;
+        memset(&fresh,0,sizeof fresh);
+        fresh.next_id=1;
+        fresh.generation=1;
+        for (int k=0;k<3;k++) fresh.change_wd[k]=-1;
+        list_unpark(&fresh);
+    }
+    cur_list=l;
+    list_set_paths(l);
+    if (!l->loaded) {
+        change_watch_files();
+        stamp_all();
+        reload_all_from_disk();
+        l->loaded=true;
+    }
+}
+
+// Frees what the current list holds in the globals.
+static void list_release(void){
+    free(archive.segs);
+    memset(&archive,0,sizeof archive);
+    search_close();
+    tl_free(&tasks);
+    tl_free(&trash);
+    str_free(&strs);
+    free(skips.v);
+    memset(&skips,0,sizeof skips);
+    for (int v=0;v<VIEW_COUNT;v++) {
+        ob_free(&view_cache[v].head);
+        ob_free(&view_cache[v].body);
+        view_cache[v].generation=0;
+    }
+    free(seen.slots);
+    memset(&seen,0,sizeof seen);
+    if (lock_fd >= 0) { close(lock_fd); lock_fd=-1; }
+}
+
+static void list_unload(NamedList *l){
+    list_enter(l);
+    list_release();
+    list_enter(&default_list);
+    free(l->parked);
+    l->parked=NULL;
+    l->loaded=false;
+}
+
+// Unloads named lists nobody has asked for in `idle` seconds.
+static void lists_evict(time_t now, time_t idle){
+    for (size_t i=0;i<n_lists;i++) {
+        NamedList *l=lists[i];
+        if (l->loaded && !l->streams && now - l->last_used >= idle) list_unload(l);
+    }
+}
+
+static size_t lists_loaded(void){
+    size_t n=1;
+    for (size_t i=0;i<n_lists;i++) n+=lists[i]->loaded;
+    return n;
+}
+
+static void list_slots_insert(NamedList *l){
+    size_t mask=list_slot_cap - 1;
+    size_t b=(size_t)fnv1a(l->name, strlen(l->name)) & mask;
+    while (list_slots[b]) b=(b+1)&mask;
+    list_slots[b]=l;
+}
+
+// The named list `name` (n bytes), registered on first sight if its
+// directory exists; NULL otherwise.
+static NamedList *list_find(const char *name, size_t n){
+    if (!list_name_ok(name,n)) return NULL;
+    if (list_slot_cap) {
+        size_t mask=list_slot_cap - 1;
+        for (size_t b=(size_t)fnv1a(name,n) & mask; list_slots[b]; b=(b+1)&mask)
+            if (strncmp(list_slots[b]->name,name,n)==0 && !list_slots[b]->name[n])
+                return list_slots[b];
+    }
+    char dir[600];
+    struct stat st;
+    snprintf(dir, sizeof dir, "%s/%.*s", lists_dir, (int)n, name);
+    if (stat(dir,&st)!=0 || !S_ISDIR(st.st_mode)) return NULL;
+
+    NamedList *l=(NamedList*)calloc(1,sizeof *l);
+    if(!l){perror("calloc"); exit(1);}
+    l->name=strndup(name,n);
+    if(!l->name){perror("strndup"); exit(1);}
+    if (n_lists == lists_cap) {
+        lists_cap = lists_cap ? lists_cap*2 : 16;
+        NamedList **p=(NamedList**)realloc(lists, lists_cap * sizeof *p);
+        if(!p){perror("realloc"); exit(1);}
+        lists=p;
+    }
+    lists[n_lists++]=l;
+    if (n_lists*2 > list_slot_cap) {
+        free(list_slots);
+        list_slot_cap = list_slot_cap ? list_slot_cap*2 : 64;
+        list_slots=(NamedList**)calloc(list_slot_cap, sizeof *list_slots);
+        if(!list_slots){perror("calloc"); exit(1);}
+        for (size_t i=0;i<n_lists;i++) list_slots_insert(lists[i]);
+    } else {
+        list_slots_insert(l);
+    }
+    return l;
+}
+
+// Registers every list directory present on disk.
+static void lists_scan(void){
+    DIR *d=opendir(lists_dir);
+    if (!d) return;
+    for (struct dirent *e=readdir(d); e; e=readdir(d))
+        list_find(e->d_name, strlen(e->d_name));
+    closedir(d);
+}
+
+// Default list first, then the named ones.
+static NamedList *list_at(size_t i){
+    return i==0 ? &default_list : lists[i-1];
+}
+
+static int cmp_list_names(const void *a, const void *b){
+    return strcmp((*(NamedList*const*)a)->name, (*(NamedList*const*)b)->name);
+}
+
+static void write_list_names_json(OutBuf *out){
+    lists_scan();
+    NamedList **sorted=(NamedList**)malloc((n_lists ? n_lists : 1) * sizeof *sorted);
+    if(!sorted){perror("malloc"); exit(1);}
+    memcpy(sorted, lists, n_lists * sizeof *sorted);
+    qsort(sorted, n_lists, sizeof *sorted, cmp_list_names);
+    ob_puts(out, "[");
+    for (size_t i=0;i<n_lists;i++) {
+        ob_puts(out, i ? ",\"" : "\"");
+        ob_json_str(out, sorted[i]->name);
+        ob_putc(out, '"');
+    }
+    ob_puts(out, "]\n");
+    free(sorted);
+}
+
+// Picks the list CLI commands work on: CLITASK_LIST, created on demand.
+static void select_cli_list(void){
+    const char *name=getenv("CLITASK_LIST");
+    if (!name || !*name) return;
+    if (!list_name_ok(name, strlen(name))) {
+        fprintf(stderr, "Invalid list name: %s\n", name);
+        exit(2);
+    }
+    char dir[600];
+    snprintf(dir, sizeof dir, "%s/%s", lists_dir, name);
+    mkdir(lists_dir, 0755);
+    mkdir(dir, 0755);
+    default_list.name=strdup(name);
+    if(!default_list.name){perror("strdup"); exit(1);}
+    set_list_paths(name);
+}
+
+// ---------- Commands, HTTP server & watcher ----------
+
+static void cmd_help(int argc, char **argv){
+    (void)argc; (void)argv;
+    print_welcome_header();
+    printf("Commands:\n");
+    printf(" add \"desc\" [date] [time] [every daily|weekdays|weekly|monthly|<N>h]\n");
+    printf(" list\n");
+    printf(" delete <id> [<id>|<from>-<to> ...]\n");
+    printf(" delete <id>@<date|epoch> # skip one occurrence of a recurring task\n");
+    printf(" delete --due-after T --due-before T\n");
+    printf(" removed [page]\n");
+    printf(" search <terms...>\n");
+    printf(" save\n");
+    printf(" import [--tsv|--jsonl] [file|-]  # bulk add\n");
+    printf(" import --store <tasks.txt> [removed.txt]  # replace the store\n");
+    printf(" export <tasks.txt> [removed.txt]\n");
+    printf(" help\n");
+    printf(" serve <port> # view tasks via HTTP at /, write at /tasks, metrics at /metrics\n");
+    printf(" watch [interval] [lead_min] [notify-cmd ... [-- notify-cmd ...]]\n");
+    printf(" stats # metrics of the running watcher\n");
+    printf(" daemon [stop] # keep lists in memory; CLI commands go through it\n");
+    printf(" bench [--sizes N,N,...] [--repeat N] [--warmup N]\n");
+    printf("\n");
+}
+
+// add "desc" [date] [time] [[every] <rule>]: with a rule the task recurs,
+// first due at the date and time given (a lone time means today, nothing
+// at all today at 23:59).
+static void cmd_add(int argc, char **argv){
+    if (argc < 1) {
+        printf("Usage: add \"desc\" [date] [time] [every <rule>]\n");
+        return;
+    }
+    char *desc = argv[0];
+    // One line per task in the journal and the text snapshot.
+    for (char *p=desc; *p; ++p) if (*p=='\n' || *p=='\r') *p=' ';
+    const char *toks[2]={NULL,NULL};
+    int ntoks=0;
+    uint32_t repeat=0;
+    for (int i=1;i<argc;i++) {
+        const char *a=argv[i];
+        bool every = strcasecmp(a,"every")==0;
+        if (every && i+1<argc) a=argv[++i];
+        if (parse_repeat(a,strlen(a),&repeat)) continue;
+        if (every) {
+            printf("Invalid repeat rule %s (daily, weekdays, weekly, monthly, hourly or <N>h).\n",
+                   i<argc ? a : "");
+            return;
+        }
+        if (ntoks<2) toks[ntoks++]=a;
+    }
+    const char *date_tok=toks[0], *time_tok=toks[1];
+    int m=0, d=0;
+    if (repeat && date_tok && !time_tok && !parse_mmdd(date_tok,&m,&d) &&
+        parse_time_token(date_tok,&m,&d)) {
+        time_tok=date_tok;
+        date_tok=NULL;
+    }
+    time_t due = parse_due(date_tok, time_tok);
+    if (repeat && !due) {
+        if (date_tok || time_tok) {
+            printf("Invalid first date for a recurring task.\n");
+            return;
+        }
+        due=parse_due("today",NULL);
+    }
+    Task t={0};
+    t.id=nextId++;
+    t.due=due;
+    t.repeat=repeat;
+    t.len=(uint32_t)strlen(desc);
+    t.desc=str_put(&strs, desc, t.len);
+    tl_push(&tasks, t);
+    char when[32];
+    fmt_when(t.due, when, sizeof when);
+    if (repeat) {
+        char rule[16];
+        repeat_name(repeat, rule, sizeof rule);
+        printf("%sAdded%s #%d: %s (due: %s, repeats %s)\n",
+               C_BLUE(), S_RESET(), t.id, task_desc(&t), when, rule);
+    } else {
+        printf("%sAdded%s #%d: %s (due: %s)\n",
+               C_BLUE(), S_RESET(), t.id, task_desc(&t), when);
+    }
+    if (journal_add(&t)) {
+        search_note_adds(t.id);
+        store_maybe_compact();
+    }
+}
+
+// Tasks due in [from, to), straight off the ordered index, with every
+// occurrence of recurring tasks in the range.
+static void print_due_range(OutBuf *out, DayFmt *days, TaskList *l, time_t from, time_t to){
+    DueIter it;
+    size_t n=0;
+    due_begin(&it, l, from, 0, 0, to);
+    for (const Task *t; (t=due_next(&it)); n++)
+        print_task_row(out, days, t);
+    due_end(&it);
+    if (!n) ob_puts(out, " (none)\n");
+    ob_putc(out, '\n');
+}
+
+// Today and tomorrow are two range scans of the ordered index and "All
+// Tasks" is its first CLITASK_ALL_LIMIT entries: O(log N + rows shown),
+// plus O(rules) for recurring tasks, each shown at its next occurrence.
+static void cmd_list(int argc, char **argv){
+    (void)argc; (void)argv;
+    print_welcome_header();
+    size_t n=tasks.live;
+    if (n==0) {
+        printf("No tasks.\n");
+        return;
+    }
+    time_t now=time(NULL);
+    time_t today=local_midnight(now,0);
+    time_t tomorrow=local_midnight(now,1);
+    time_t day_after=local_midnight(now,2);
+    size_t limit = env_limit("CLITASK_ALL_LIMIT", 20);
+
+    OutBuf out={0};
+    DayFmt days={0};
+    ob_printf(&out, "%sToday's Tasks%s\n", C_BLUE(), S_RESET());
+    print_table_head(&out);
+    print_due_range(&out, &days, &tasks, today, tomorrow);
+
+    ob_printf(&out, "%sTomorrow's Tasks%s\n", C_BLACK(), S_RESET());
+    print_table_head(&out);
+    print_due_range(&out, &days, &tasks, tomorrow, day_after);
+
+    ob_printf(&out, "%sAll Tasks%s (sorted by due; undated last)\n", C_BLUE(), S_RESET());
+    print_table_head(&out);
+    DueIter it;
+    due_begin(&it, &tasks, 0, 0, 0, 0);
+    const Task *t;
+    for (size_t i = 0; i < limit && (t=due_next(&it)); i++)
+	    print_task_row(&out, &days, t);
+    due_end(&it);
+    if (n > limit)
+	    ob_printf(&out, "... (%zu more)\n", n - limit);
+
+    fflush(stdout);
+    ob_flush_fd(&out, STDOUT_FILENO);
+    ob_free(&out);
+}
+
+static bool delete_one(int id, OutBuf *rec){
+    Task t;
+    if(!tl_remove(&tasks,id,&t)) return false;
+    tl_push(&trash,t);
+    char buf[32];
+    int n=journal_format_delete(buf,sizeof buf,id);
+    ob_put(rec,buf,(size_t)n);
+    return true;
+}
+
+// Deletes the live ids in [a, b]: id by id when the range is shorter
+// than the list, else in one pass over the arena (removal never moves
+// records), so a huge range costs O(N), not O(b-a).
+static void delete_range(int a, int b, OutBuf *rec){
+    if ((long long)b - a < (long long)tasks.live) {
+        for (long long k=a;k<=b;k++) delete_one((int)k,rec);
+        return;
+    }
+    for (size_t i=0;i<tasks.len;i++) {
+        int id=tasks.recs[i].id;
+        if (id && id>=a && id<=b) delete_one(id,rec);
+    }
+}
+
+// Records `<id>@<when>` as a deleted occurrence: the one at epoch `when`,
+// or for a date the first one that day. False if there is none.
+static bool skip_one(const char *arg, OutBuf *rec){
+    const char *at=strchr(arg,'@');
+    char idbuf[16];
+    int id=0;
+    snprintf(idbuf, sizeof idbuf, "%.*s", (int)(at-arg), arg);
+    const Task *r = parseInt(idbuf,&id)==0 ? tl_find(&tasks,id) : NULL;
+    if (!r) { printf("Task %s not found.\n", idbuf); return false; }
+    if (!r->repeat) { printf("Task %d does not repeat.\n", id); return false; }
+    time_t v=parse_time_arg(at+1);
+    if (!v) { printf("Invalid time %s.\n", at+1); return false; }
+    bool epoch = strspn(at+1,"0123456789")==strlen(at+1);
+    time_t occ = epoch ? repeat_next(r,v) : repeat_next(r,local_midnight(v,0));
+    if (epoch ? occ!=v : occ>=local_midnight(v,1)) {
+        printf("Task %d has no occurrence at %s.\n", id, at+1);
+        return false;
+    }
+    skip_add(id,occ);
+    char when[32];
+    fmt_when(occ, when, sizeof when);
+    printf("%sSkipped%s #%d on %s.\n", C_RED(), S_RESET(), id, when);
+    char buf[48];
+    int n=journal_format_skip(buf,sizeof buf,id,occ);
+    ob_put(rec,buf,(size_t)n);
+    return true;
+}
+
+// delete <id>            one task
+// delete <id|a-b> ...    several ids and id ranges
+// delete <id>@<when>     one occurrence of a recurring task
+// delete --due-after T --due-before T   every one-off task due in (T, T)
+// Bulk forms journal all removals in one write.
+static void cmd_delete(int argc, char **argv){
+    if (argc<1){
+        printf("Usage: delete <id> [<id>|<from>-<to> ...] | --due-after T --due-before T\n");
+        return;
+    }
+    int id=0;
+    if (argc==1 && parseInt(argv[0],&id)==0) {
+        Task t;
+        if(!tl_remove(&tasks,id,&t)){
+            printf("Task %d not found.\n", id);
+            return;
+        }
+        tl_push(&trash,t);
+        printf("%sRemoved%s #%d.\n", C_RED(), S_RESET(), id);
+        if (journal_delete(id)) store_maybe_compact();
+        return;
+    }
+    double t0=mono_seconds();
+    OutBuf rec={0};
+    time_t after=0, before=0;
+    bool by_due=false;
+    size_t skipped=0, missing=0;
+    for (int i=0;i<argc;i++) {
+        int a=0, b=0;
+        if (strchr(argv[i],'@')) {
+            if (!skip_one(argv[i],&rec)) { ob_free(&rec); return; }
+            skipped++;
+        } else if ((strcmp(argv[i],"--due-after")==0 || strcmp(argv[i],"--due-before")==0) && i+1<argc) {
+            time_t v=parse_time_arg(argv[i+1]);
+            if (!v) { printf("Invalid time %s.\n", argv[i+1]); ob_free(&rec); return; }
+            if (argv[i][6]=='a') after=v; else before=v;
+            by_due=true;
+            i++;
+        } else if (parseInt(argv[i],&a)==0) {
+            if (!delete_one(a,&rec)) missing++;
+        } else if (sscanf(argv[i],"%d-%d",&a,&b)==2 && a<=b) {
+            delete_range(a,b,&rec);
+        } else {
+            printf("Invalid id %s.\n", argv[i]);
+            ob_free(&rec);
+            return;
+        }
+    }
+    if (by_due) {
+        // A range scan of the ordered index, collected first since each
+        // delete reshapes the tree under the iterator.
+        OrdIter it;
+        if (after) tl_seek(&tasks,after+1,0,&it);
+        else tl_seek_first(&tasks,&it);
+        int *ids=NULL;
+        size_t n=0, cap=0;
+        for (const Task *t; (t=tl_next(&tasks,&it)); ) {
+            if (!t->due || (before && t->due >= before)) break;
+            if (t->repeat) continue;
+            if (n==cap) {
+                cap = cap ? cap*2 : 64;
+                int *p=(int*)realloc(ids,cap * sizeof *p);
+                if(!p){perror("realloc"); exit(1);}
+                ids=p;
+            }
+            ids[n++]=t->id;
+        }
+        for (size_t i=0;i<n;i++) delete_one(ids[i],&rec);
+        free(ids);
+    }
+    size_t removed=0;
+    for (size_t i=0;i<rec.len;i++) if (rec.data[i]=='\n') removed++;
+    if (rec.len && journal_write(rec.data,rec.len)) store_maybe_compact();
+    ob_free(&rec);
+    removed-=skipped;
+    if (removed || !skipped) report_throughput("Removed", removed, mono_seconds()-t0);
+    if (missing) printf("%zu id%s not found.\n", missing, missing==1 ? "" : "s");
+}
+
+// Prints l newest first, skipping *skip tasks; returns how many of
+// `left` rows are still wanted.
+static size_t print_removed_range(OutBuf *out, DayFmt *days, const TaskList *l,
+                                  size_t *skip, size_t left){
+    for (size_t i=l->len; i-- > 0 && left;) {
+        const Task *t=&l->recs[i];
+        if (!t->id) continue;
+        if (*skip) { (*skip)--; continue; }
+        print_task_row(out, days, t);
+        left--;
+    }
+    return left;
+}
+
+// removed [page]: newest first, CLITASK_REMOVED_PAGE rows per page. Sealed
+// segments are skipped by their indexed counts and read only when the
+// page reaches into them.
+static void cmd_removed(int argc, char **argv){
+    int page=1;
+    if (argc >= 1 && (parseInt(argv[0],&page)!=0 || page < 1)) {
+        printf("Usage: removed [page]\n");
+        return;
+    }
+    trash_need();
+    size_t total=removed_total();
+    if(!total){
+        printf("Removed is empty.\n");
+        return;
+    }
+    size_t per=env_limit("CLITASK_REMOVED_PAGE", 50);
+    size_t pages=(total+per-1)/per;
+    size_t skip=((size_t)page-1)*per;
+    OutBuf out={0};
+    DayFmt days={0};
+    ob_printf(&out, "%sRemoved Tasks%s\n", C_RED(), S_RESET());
+    print_table_head(&out);
+    size_t left=print_removed_range(&out, &days, &trash, &skip, per);
+    for (size_t i=archive.n; i-- > 0 && left;) {
+        const Segment *sg=&archive.segs[i];
+        if (skip >= sg->count) { skip-=sg->count; continue; }
+        TaskList l;
+        memset(&l,0,sizeof l);
+        archive_load_segment(sg,&l);
+        left=print_removed_range(&out, &days, &l, &skip, left);
+        tl_free(&l);
+    }
+    if (pages > 1) {
+        ob_printf(&out, "Page %d of %zu (%zu removed).", page, pages, total);
+        if ((size_t)page < pages) ob_printf(&out, " Older: removed %d", page+1);
+        ob_putc(&out, '\n');
+    }
+    fflush(stdout);
+    ob_flush_fd(&out, STDOUT_FILENO);
+    ob_free(&out);
+}
+
+static void print_matches(OutBuf *out, DayFmt *days, const Task **rows,
+                          size_t n, size_t limit){
+    qsort(rows,n,sizeof *rows,cmp_task_ptrs);
+    for (size_t i=0;i<n && i<limit;i++) print_task_row(out, days, rows[i]);
+    if (!n) ob_puts(out, " (none)\n");
+    if (n > limit) ob_printf(out, "... (%zu more)\n", n - limit);
+    ob_putc(out, '\n');
+}
+
+// search <terms...>: tasks whose description contains every term.
+static void cmd_search(int argc, char **argv){
+    if (argc < 1) {
+        printf("Usage: search <terms...>\n");
+        return;
+    }
+    char query[512]="";
+    size_t qlen=0;
+    for (int i=0;i<argc;i++) {
+        int k=snprintf(query+qlen,sizeof query - qlen,"%s%s",i ? " " : "",argv[i]);
+        if (k<0 || (size_t)k >= sizeof query - qlen) break;
+        qlen+=(size_t)k;
+    }
+    size_t n=0;
+    int32_t *ids=search_query(query,&n);
+    const Task **act=(const Task**)malloc((n ? n : 1) * sizeof *act);
+    const Task **rem=(const Task**)malloc((n ? n : 1) * sizeof *rem);
+    Task *vals=(Task*)malloc((tasks.nrules ? tasks.nrules : 1) * sizeof *vals);
+    if(!act || !rem || !vals){perror("malloc"); exit(1);}
+    size_t na=0, nr=0, nm=0, nvals=0;
+    for (size_t i=0;i<n;i++) {
+        const Task *t=tl_find(&tasks,ids[i]);
+        if (t) {
+            act[na++]=task_upcoming(t,vals,&nvals);
+            continue;
+        }
+        trash_need();
+        if ((t=tl_find(&trash,ids[i]))) rem[nr++]=t;
+        else ids[nm++]=ids[i];      // archived; still ascending
+    }
+    TaskList archived;
+    memset(&archived,0,sizeof archived);
+    archive_collect(ids,nm,&archived);
+    for (size_t i=0;i<archived.len;i++)
+        if (archived.recs[i].id) rem[nr++]=&archived.recs[i];
+    free(ids);
+
+    size_t limit = env_limit("CLITASK_ALL_LIMIT", 20);
+    OutBuf out={0};
+    DayFmt days={0};
+    ob_printf(&out, "%sMatching Tasks%s (%zu)\n", C_BLUE(), S_RESET(), na);
+    print_table_head(&out);
+    print_matches(&out, &days, act, na, limit);
+    ob_printf(&out, "%sMatching Removed Tasks%s (%zu)\n", C_RED(), S_RESET(), nr);
+    print_table_head(&out);
+    print_matches(&out, &days, rem, nr, limit);
+
+    fflush(stdout);
+    ob_flush_fd(&out, STDOUT_FILENO);
+    ob_free(&out);
+    free((void*)act);
+    free((void*)rem);
+    free(vals);
+    tl_free(&archived);
+}
+
+static void cmd_save(int argc, char **argv){
+    (void)argc; (void)argv;
+    store_compact(true);
+}
+
+// Reads the four hex digits after the 'u' at *p, leaving *p on the last.
+static unsigned json_hex4(const char **p){
+    char hex[5]={0};
+    for (int k=0;k<4 && (*p)[1];k++) hex[k]=*++*p;
+    return (unsigned)strtoul(hex,NULL,16);
+}
+
+// Reads one JSON string starting at the opening quote; decodes escapes
+// (\uXXXX, surrogate pairs included, to UTF-8) into out, truncating at
+// L-1 bytes. \u0000 and unpaired surrogates become U+FFFD: the one would
+// cut the string short, the others are not valid UTF-8.
+static const char *json_read_string(const char *p, char *out, size_t L){
+    size_t n=0;
+    for (p++; *p && *p!='"'; p++) {
+        if (*p!='\\') {             // raw bytes, UTF-8 already
+            if (n + 1 < L) out[n++]=*p;
+            continue;
+        }
+        unsigned cp;
+        p++;
+        switch (*p) {
+        case 'n': cp='\n'; break;
+        case 't': cp='\t'; break;
+        case 'r': cp='\r'; break;
+        case 'b': cp='\b'; break;
+        case 'f': cp='\f'; break;
+        case 'u':
+            cp=json_hex4(&p);
+            if (cp>=0xd800 && cp<0xdc00 && p[1]=='\\' && p[2]=='u') {
+                const char *q=p+2;
+                unsigned lo=json_hex4(&q);
+                if (lo>=0xdc00 && lo<0xe000) {
+                    cp=0x10000 + ((cp-0xd800)<<10) + (lo-0xdc00);
+                    p=q;
+                }
+            }
+            if (cp==0 || (cp>=0xd800 && cp<0xe000)) cp=0xfffd;
+            break;
+        case '\0': p--; continue;
+        default: cp=(unsigned char)*p;
+        }
+        char enc[4];
+        size_t k;
+        if (cp < 0x80) { enc[0]=(char)cp; k=1; }
+        else if (cp < 0x800) { enc[0]=(char)(0xc0|(cp>>6)); enc[1]=(char)(0x80|(cp&0x3f)); k=2; }
+        else if (cp < 0x10000) { enc[0]=(char)(0xe0|(cp>>12)); enc[1]=(char)(0x80|((cp>>6)&0x3f));
+               enc[2]=(char)(0x80|(cp&0x3f)); k=3; }
+        else { enc[0]=(char)(0xf0|(cp>>18)); enc[1]=(char)(0x80|((cp>>12)&0x3f));
+               enc[2]=(char)(0x80|((cp>>6)&0x3f)); enc[3]=(char)(0x80|(cp&0x3f)); k=4; }
+        if (n + k < L) { memcpy(out+n,enc,k); n+=k; }
+    }
+    if (L) out[n]='\0';
+    return *p=='"' ? p+1 : p;
+}
+
+// Pulls description/due/date/time/repeat out of the next flat JSON object
+// in p and returns where it ends, or NULL if there is none. A numeric due
+// is epoch seconds, a string one "[date] [time]" as for `add`. desc must
+// hold DL bytes; strlen(p)+1 is always enough.
+static const char *jsonl_parse(const char *p, char *desc, size_t DL, char *date,
+                               char *tm, char *rule, size_t TL, time_t *due){
+    while (*p && *p!='{') p++;
+    if (!*p) return NULL;
+    p++;
+    for (;;) {
+        while (isspace((unsigned char)*p) || *p==',') p++;
+        if (*p!='"') break;
+        char key[32];
+        p=json_read_string(p,key,sizeof key);
+        while (isspace((unsigned char)*p) || *p==':') p++;
+        bool is_desc = strcmp(key,"description")==0 || strcmp(key,"desc")==0;
+        char buf[1024];
+        char *val = is_desc ? desc : buf;
+        size_t VL = is_desc ? DL : sizeof buf;
+        bool quoted = *p=='"';
+        if (quoted) {
+            p=json_read_string(p,val,VL);
+        } else {
+            size_t n=strcspn(p,",}");
+            if (n >= VL) n = VL - 1;
+            memcpy(val,p,n);
+            val[n]='\0';
+            while (n && isspace((unsigned char)val[n-1])) val[--n]='\0';
+            p+=strcspn(p,",}");
+        }
+        if (is_desc) continue;
+        if (strcmp(key,"due")==0 && quoted)
+            split_due(val,date,tm,TL);
+        else if (strcmp(key,"due")==0 && strcmp(val,"null")!=0)
+            *due=(time_t)strtoll(val,NULL,10);
+        else if (strcmp(key,"date")==0)
+            copy_bounded(date,TL,val);
+        else if (strcmp(key,"time")==0)
+            copy_bounded(tm,TL,val);
+        else if (strcmp(key,"repeat")==0 && strcmp(val,"null")!=0)
+            copy_bounded(rule,TL,val);
+    }
+    return *p=='}' ? p+1 : p;
+}
+
+// Sets t's due and repeat from add's date, time and rule tokens (a bare
+// number as the date is epoch seconds) or from due, an epoch already
+// read. Returns what is wrong with them, or NULL.
+static const char *task_fields(const char *date, const char *tm, const char *rule,
+                               time_t due, Task *t){
+    if (date[0] || tm[0]) {
+        char *end=NULL;
+        long long epoch=strtoll(date,&end,10);
+        if (date[0] && *end=='\0' && !tm[0]) due=(time_t)epoch;
+        else due=parse_due(date[0]?date:NULL, tm[0]?tm:NULL);
+        if (!due) return "bad date/time";
+    }
+    uint32_t repeat=0;
+    if (rule[0] && !parse_repeat(rule,strlen(rule),&repeat)) return "bad repeat rule";
+    if (repeat && !due) due=parse_due("today",NULL);
+    t->due=due;
+    t->repeat=repeat;
+    return NULL;
+}
+
+enum { IMPORT_STORE, IMPORT_TSV, IMPORT_JSONL };
+
+// Tab-separated input is `desc<TAB>[date]<TAB>[time]<TAB>[repeat]` with
+// the same date, time and rule tokens as `add` (a bare number is taken as
+// epoch seconds).
+// Each line gets the next id; the whole batch goes to the journal in a
+// single write at the end.
+static void import_bulk(FILE *in, const char *name, int format){
+    double t0=mono_seconds();
+    size_t added=0, rejected=0, lineno=0;
+    char *line=NULL, *desc=NULL;
+    size_t cap=0, desc_cap=0;
+    OutBuf rec={0};
+    int first=nextId;
+    while (getline(&line,&cap,in) > 0) {
+        lineno++;
+        line[strcspn(line,"\r\n")]='\0';
+        if (!line[0] || line[0]=='#') continue;
+        size_t DL=strlen(line)+1;
+        if (DL > desc_cap) {
+            char *d=(char*)realloc(desc,DL);
+            if(!d){perror("realloc"); exit(1);}
+            desc=d;
+            desc_cap=DL;
+        }
+        char date[32]="", tm[32]="", rule[32]="";
+        desc[0]='\0';
+        time_t due=0;
+        if (format==IMPORT_JSONL) {
+            if (!jsonl_parse(line,desc,DL,date,tm,rule,sizeof date,&due)) desc[0]='\0';
+        } else {
+            char *f[4]={line,NULL,NULL,NULL};
+            for (int k=1;k<4 && f[k-1];k++) {
+                f[k]=strchr(f[k-1],'\t');
+                if (f[k]) *f[k]++='\0';
+            }
+            copy_bounded(desc,DL,f[0]);
+            if (f[1]) copy_bounded(date,sizeof date,f[1]);
+            if (f[2]) copy_bounded(tm,sizeof tm,f[2]);
+            if (f[3]) copy_bounded(rule,sizeof rule,f[3]);
+        }
+        for (char *p=desc; *p; ++p) if (*p=='\n' || *p=='\r') *p=' ';
+        if (!desc[0]) {
+            if (rejected++ < 5) fprintf(stderr,"%s:%zu: missing description\n",name,lineno);
+            continue;
+        }
+        Task t={0};
+        const char *bad=task_fields(date,tm,rule,due,&t);
+        if (bad) {
+            if (rejected++ < 5) fprintf(stderr,"%s:%zu: %s\n",name,lineno,bad);
+            continue;
+        }
+        t.id=nextId++;
+        t.len=(uint32_t)strlen(desc);
+        t.desc=str_put(&strs,desc,t.len);
+        tl_push(&tasks,t);
+        ob_reserve(&rec,t.len + JOURNAL_ADD_EXTRA);
+        int n=journal_format_add(rec.data + rec.len, rec.cap - rec.len, &t);
+        if (n>0) rec.len+=(size_t)n;
+        added++;
+    }
+    free(line);
+    free(desc);
+    if (rec.len && journal_write(rec.data,rec.len)) {
+        search_note_adds(first);
+        store_maybe_compact();
+    }
+    ob_free(&rec);
+    report_throughput("Imported", added, mono_seconds()-t0);
+    if (rejected) printf("%zu line%s rejected.\n", rejected, rejected==1 ? "" : "s");
+}
+
+// import --store and export convert between the configured store and the
+// text format, e.g. CLITASK_STORE=binary task_manager import --store
+// tasks.txt removed.txt
+static void import_store(int argc, char **argv){
+    TaskList a, r;
+    memset(&a,0,sizeof a);
+    memset(&r,0,sizeof r);
+    SkipSet kept=skips;
+    memset(&skips,0,sizeof skips);
+    int next=1;
+    load_file_text(argv[0], &a, &next);
+    if (argc >= 2) load_file_text(argv[1], &r, &next);
+    if (!a.live && !r.live) {
+        printf("Nothing to import from %s.\n", argv[0]);
+        free(skips.v);
+        skips=kept;
+        return;
+    }
+    free(kept.v);
+    tl_free(&tasks);
+    tl_free(&trash);
+    tasks=a;
+    trash=r;
+    trash_loaded=true;
+    nextId=next;
+    for (size_t i=0;i<archive.n;i++) {
+        char path[540];
+        segment_path(archive.segs[i].seq,path,sizeof path);
+        unlink(path);
+    }
+    archive.n=0;
+    archive.head_first = trash.live ? time(NULL) : 0;
+    unlink(index_file);     // ids now name different tasks
+    if (store_compact(false))
+        printf("Imported %zu active, %zu removed into %s.\n",
+               tasks.live, trash.live, active_file);
+}
+
+static bool has_suffix(const char *s, const char *suf){
+    size_t a=strlen(s), b=strlen(suf);
+    return a>=b && strcmp(s+a-b,suf)==0;
+}
+
+// import [--store|--tsv|--jsonl] [file|-]
+//   --store  replace the store with text snapshots (tasks.txt [removed.txt])
+//   --tsv / --jsonl  append new tasks in bulk; JSONL for files ending in
+//   .jsonl / .json, TSV for anything else. Only --store replaces data.
+static void cmd_import(int argc, char **argv){
+    int format=-1;
+    if (argc >= 1 && strncmp(argv[0],"--",2)==0) {
+        if (strcmp(argv[0],"--store")==0) format=IMPORT_STORE;
+        else if (strcmp(argv[0],"--tsv")==0) format=IMPORT_TSV;
+        else if (strcmp(argv[0],"--jsonl")==0) format=IMPORT_JSONL;
+        else { printf("Unknown import format %s.\n", argv[0]); return; }
+        argc--; argv++;
+    }
+    const char *path = argc>=1 ? argv[0] : "-";
+    if (format < 0)
+        format = has_suffix(path,".jsonl") || has_suffix(path,".json") ? IMPORT_JSONL : IMPORT_TSV;
+    if (format==IMPORT_STORE) {
+        if (argc < 1) {
+            printf("Usage: import --store <tasks.txt> [removed.txt]\n");
+            return;
+        }
+        import_store(argc, argv);
+        return;
+    }
+    FILE *in = strcmp(path,"-")==0 ? stdin : fopen(path,"r");
+    if (!in) { perror(path); return; }
+    import_bulk(in, strcmp(path,"-")==0 ? "stdin" : path, format);
+    if (in != stdin) fclose(in);
+}
+
+static void cmd_export(int argc, char **argv){
+    if (argc < 1) {
+        printf("Usage: export <tasks.txt> [removed.txt]\n");
+        return;
+    }
+    if (!save_file_text(argv[0], &tasks, true)) return;
+    if (argc < 2) return;
+    // The whole history, oldest first, as one removed file.
+    trash_need();
+    TaskList all;
+    memset(&all,0,sizeof all);
+    archive_load_all(&all);
+    for (size_t i=0;i<trash.len;i++)
+        if (trash.recs[i].id) tl_push(&all,trash.recs[i]);
+    save_file_text(argv[1], &all, true);
+    tl_free(&all);
+}
+
+static volatile sig_atomic_t srv_running = 1;
+
+static void handle_sigint(int sig){
+    (void)sig;
+    srv_running = 0;
+}
+
+// Readiness notification for the server loop: epoll on Linux, poll()
+// elsewhere. Only what cmd_serve needs: level-triggered in/out interest.
+
+#define EV_IN  1
+#define EV_OUT 2
+
+typedef struct {
+    int fd;
+    int events;
+} Event;
+
+#ifdef __linux__
+static int ev_fd = -1;
+
+static bool ev_init(void){
+    ev_fd=epoll_create1(EPOLL_CLOEXEC);
+    return ev_fd>=0;
+}
+
+static void ev_ctl(int op, int fd, int events){
+    struct epoll_event e;
+    memset(&e,0,sizeof e);
+    e.events=((events&EV_IN)?EPOLLIN:0u) | ((events&EV_OUT)?EPOLLOUT:0u);
+    e.data.fd=fd;
+    if (epoll_ctl(ev_fd,op,fd,&e)<0 && op!=EPOLL_CTL_DEL) perror("epoll_ctl");
+}
+
+static void ev_add(int fd, int events){ ev_ctl(EPOLL_CTL_ADD,fd,events); }
+static void ev_mod(int fd, int events){ ev_ctl(EPOLL_CTL_MOD,fd,events); }
+static void ev_del(int fd){ ev_ctl(EPOLL_CTL_DEL,fd,0); }
+
+static int ev_wait(Event *out, int max, int timeout_ms){
+    struct epoll_event evs[64];
+    if (max > 64) max = 64;
+    int n=epoll_wait(ev_fd,evs,max,timeout_ms);
+    for (int i=0;i<n;i++) {
+        out[i].fd=evs[i].data.fd;
+        out[i].events=((evs[i].events&(EPOLLIN|EPOLLHUP|EPOLLERR))?EV_IN:0) |
+                      ((evs[i].events&EPOLLOUT)?EV_OUT:0);
+    }
+    return n;
+}
+
+static void ev_close(void){
+    close(ev_fd);
+    ev_fd=-1;
+}
+#else
+static struct pollfd *ev_pfds;
+static nfds_t ev_n, ev_cap;
+
+static bool ev_init(void){
+    ev_n=0;
+    return true;
+}
+
+static short ev_poll_events(int events){
+    return (short)(((events&EV_IN)?POLLIN:0) | ((events&EV_OUT)?POLLOUT:0));
+}
+
+static void ev_add(int fd, int events){
+    if (ev_n==ev_cap) {
+        nfds_t cap=ev_cap ? ev_cap*2 : 64;
+        struct pollfd *p=(struct pollfd*)realloc(ev_pfds,cap * sizeof *p);
+        if(!p){perror("realloc"); exit(1);}
+        ev_pfds=p;
+        ev_cap=cap;
+    }
+    ev_pfds[ev_n].fd=fd;
+    ev_pfds[ev_n].events=ev_poll_events(events);
+    ev_pfds[ev_n].revents=0;
+    ev_n++;
+}
+
+static void ev_mod(int fd, int events){
+    for (nfds_t i=0;i<ev_n;i++)
+        if (ev_pfds[i].fd==fd) ev_pfds[i].events=ev_poll_events(events);
+}
+
+static void ev_del(int fd){
+    for (nfds_t i=0;i<ev_n;i++)
+        if (ev_pfds[i].fd==fd) { ev_pfds[i]=ev_pfds[--ev_n]; return; }
+}
+
+static int ev_wait(Event *out, int max, int timeout_ms){
+    int r=poll(ev_pfds,ev_n,timeout_ms);
+    if (r<=0) return r;
+    int n=0;
+    for (nfds_t i=0;i<ev_n && n<max;i++) {
+        short re=ev_pfds[i].revents;
+        if (!re) continue;
+        out[n].fd=ev_pfds[i].fd;
+        out[n].events=((re&(POLLIN|POLLHUP|POLLERR))?EV_IN:0) |
+                      ((re&POLLOUT)?EV_OUT:0);
+        n++;
+    }
+    return n;
+}
+
+static void ev_close(void){
+    free(ev_pfds);
+    ev_pfds=NULL;
+    ev_n=ev_cap=0;
+}
+#endif
+
+static void write_all_tasks_text(OutBuf *out){
+    DueIter it;
+    due_begin(&it, &tasks, 0, 0, 0, 0);
+    print_table_head(out);
+    DayFmt days={0};
+    for (const Task *t; (t=due_next(&it)); )
+        print_task_row(out, &days, t);
+    due_end(&it);
+}
+
+static void write_task_json(OutBuf *out, DayFmt *days, const Task *t, bool removed){
+    char when[32];
+    fmt_when_day(days, t->due, when, sizeof when);
+    ob_puts(out, " {\"id\":");
+    ob_int(out, t->id);
+    ob_puts(out, ",\"due\":");
+    ob_int(out, (long long)t->due);
+    ob_puts(out, ",\"when\":\"");
+    ob_puts(out, when);
+    ob_puts(out, "\",\"description\":\"");
+    ob_json_str(out, task_desc(t));
+    if (t->repeat) {
+        char rule[16];
+        repeat_name(t->repeat, rule, sizeof rule);
+        ob_puts(out, "\",\"repeat\":\"");
+        ob_puts(out, rule);
+    }
+    ob_puts(out, removed ? "\",\"removed\":true}" : "\"}");
+}
+
+static void write_all_tasks_json(OutBuf *out){
+    DueIter it;
+    due_begin(&it, &tasks, 0, 0, 0, 0);
+    ob_puts(out, "[\n");
+    DayFmt days={0};
+    size_t n=0;
+    for (const Task *t; (t=due_next(&it)); n++){
+        if (n) ob_puts(out, ",\n");
+        write_task_json(out, &days, t, false);
+    }
+    due_end(&it);
+    ob_puts(out, n ? "\n]\n" : "]\n");
+}
+
+static void metric_line(OutBuf *out, const char *name, const char *type,
+                        const char *help, uint64_t v){
+    ob_printf(out, "# HELP %s %s\n# TYPE %s %s\n%s %llu\n",
+              name, help, name, type, name, (unsigned long long)v);
+}
+
+// Threads of a threaded serve (CLITASK_HTTP_THREADS). Each keeps its own
+// request counters, guarded by a mutex only it and a /metrics render take.
+typedef struct {
+    pthread_t       tid;
+    unsigned long   epoch;       // odd while picking up the snapshot
+    pthread_mutex_t mu;
+    uint64_t        requests;
+    uint64_t        bytes_written;
+    Histogram       request, write;
+} Worker;
+
+static Worker *workers;
+static int n_workers;
+
+// Prometheus text exposition of `metrics` plus list sizes.
+static void write_metrics(OutBuf *out){
+    uint64_t requests=metrics.requests, bytes=metrics.bytes_written;
+    Histogram phase[PH_COUNT];
+    memcpy(phase, metrics.phase, sizeof phase);
+    for (int i=0;i<n_workers;i++) {
+        Worker *w=&workers[i];
+        pthread_mutex_lock(&w->mu);
+        requests+=w->requests;
+        bytes+=w->bytes_written;
+        hist_merge(&phase[PH_REQUEST], &w->request);
+        hist_merge(&phase[PH_WRITE], &w->write);
+        pthread_mutex_unlock(&w->mu);
+    }
+    metric_line(out, "clitask_http_requests_total", "counter",
+                "HTTP requests served.", requests);
+    metric_line(out, "clitask_http_bytes_written_total", "counter",
+                "Bytes written to HTTP clients.", bytes);
+    metric_line(out, "clitask_http_connections_total", "counter",
+                "HTTP connections accepted.", metrics.connections);
+    metric_line(out, "clitask_http_writes_total", "counter",
+                "Task writes received over HTTP.", metrics.writes);
+    metric_line(out, "clitask_http_write_batches_total", "counter",
+                "Journal appends the HTTP writes were coalesced into.",
+                metrics.write_batches);
+    metric_line(out, "clitask_store_reloads_total", "counter",
+                "Full reloads of the store files.", metrics.reloads);
+    metric_line(out, "clitask_store_replays_total", "counter",
+                "Journal tail replays.", metrics.replays);
+    metric_line(out, "clitask_notifications_total", "counter",
+                "Reminders fired.", metrics.notifications);
+    metric_line(out, "clitask_notify_failures_total", "counter",
+                "Notify commands that failed to start or exited non-zero.",
+                metrics.notify_failures);
+    metric_line(out, "clitask_notify_timeouts_total", "counter",
+                "Notify commands killed for running too long.", metrics.notify_timeouts);
+    ob_puts(out, "# HELP clitask_tasks Tasks in the store.\n# TYPE clitask_tasks gauge\n");
+    ob_printf(out, "clitask_tasks{list=\"active\"} %zu\n", tasks.live);
+    ob_printf(out, "clitask_tasks{list=\"removed\"} %zu\n", removed_total());
+    metric_line(out, "clitask_lists_loaded", "gauge",
+                "Task lists held in memory.", lists_loaded());
+    metric_line(out, "clitask_start_time_seconds", "gauge",
+                "Unix time the process started.", (uint64_t)metrics.started);
+
+    ob_puts(out, "# HELP clitask_phase_seconds Time spent per phase "
+                 "(render includes building the ordered index).\n"
+                 "# TYPE clitask_phase_seconds histogram\n");
+    for (int p=0;p<PH_COUNT;p++) {
+        const Histogram *h=&phase[p];
+        uint64_t cum=0;
+        for (size_t b=0;b<HIST_BUCKETS-1;b++) {
+            cum+=h->buckets[b];
+            ob_printf(out, "clitask_phase_seconds_bucket{phase=\"%s\",le=\"%g\"} %llu\n",
+                      phase_names[p], (double)(1ull<<b)/1e6, (unsigned long long)cum);
+        }
+        cum+=h->buckets[HIST_BUCKETS-1];
+        ob_printf(out, "clitask_phase_seconds_bucket{phase=\"%s\",le=\"+Inf\"} %llu\n",
+                  phase_names[p], (unsigned long long)cum);
+        ob_printf(out, "clitask_phase_seconds_sum{phase=\"%s\"} %.6f\n",
+                  phase_names[p], h->sum);
+        ob_printf(out, "clitask_phase_seconds_count{phase=\"%s\"} %llu\n",
+                  phase_names[p], (unsigned long long)h->count);
+    }
+}
+
+// One HTTP/1.1 connection. Requests are parsed out of `in` as they
+// complete, so partial reads and pipelined requests both work; responses
+// queue in `out` in request order and drain as the socket allows.
+
+#define HTTP_REQ_MAX 8192
+
+typedef struct Stream Stream;
+static void stream_free(Stream *st);
+typedef struct Conn Conn;
+static void writes_forget(const Conn *c);
+
+struct Conn {
+    int    fd;
+    char   in[HTTP_REQ_MAX];
+    size_t in_len;
+    OutBuf out;
+    size_t out_off;          // bytes of `out` already sent
+    time_t last_active;
+    bool   closing;          // close once `out` has drained
+    bool   eof;              // the client has finished sending
+    bool   busy;             // handed to a worker thread
+    bool   queued;           // waiting for its write to be batched
+    Stream *stream;          // response still being rendered, if any
+};
+
+static Conn **conns;         // indexed by fd
+static size_t conns_cap;
+
+static Conn *conn_new(int fd){
+    if ((size_t)fd >= conns_cap) {
+        size_t cap=conns_cap ? conns_cap : 64;
+        while (cap <= (size_t)fd) cap*=2;
+        Conn **p=(Conn**)realloc(conns,cap * sizeof *p);
+        if(!p){perror("realloc"); exit(1);}
+        memset(p+conns_cap,0,(cap-conns_cap) * sizeof *p);
+        conns=p;
+        conns_cap=cap;
+    }
+    Conn *c=(Conn*)calloc(1,sizeof *c);
+    if(!c){perror("calloc"); exit(1);}
+    c->fd=fd;
+    c->last_active=time(NULL);
+    conns[fd]=c;
+    return c;
+}
+
+static void conn_close(Conn *c){
+    if (c->queued) writes_forget(c);
+    ev_del(c->fd);
+    close(c->fd);
+    conns[c->fd]=NULL;
+    ob_free(&c->out);
+    stream_free(c->stream);
+    free(c);
+}
+
+static void conn_out(Conn *c, const void *data, size_t len){
+    ob_put(&c->out, data, len);
+}
+
+// Sends ready-made buffers with one writev when nothing is queued ahead
+// of them; whatever the socket does not take is queued for conn_flush.
+static void conn_send_iov(Conn *c, struct iovec *iov, int cnt){
+    size_t skip=0;
+    if (c->out.len == c->out_off) {
+        double t0=mono_seconds();
+        ssize_t w=writev(c->fd, iov, cnt);
+        metric_observe(PH_WRITE, mono_seconds()-t0);
+        if (w>0) {
+            skip=(size_t)w;
+            metrics.bytes_written+=(uint64_t)w;
+            c->last_active=time(NULL);
+        }
+    }
+    for (int i=0;i<cnt;i++) {
+        if (skip >= iov[i].iov_len) { skip-=iov[i].iov_len; continue; }
+        conn_out(c, (const char*)iov[i].iov_base + skip, iov[i].iov_len - skip);
+        skip=0;
+    }
+}
+
+static void http_respond(Conn *c, const char *status, const char *ctype,
+                         const char *body, size_t len, bool keep_alive){
+    char hdr[256];
+    int n=snprintf(hdr,sizeof hdr,
+        "HTTP/1.1 %s\r\n"
+        "Content-Type: %s; charset=utf-8\r\n"
+        "Content-Length: %zu\r\n"
+        "Cache-Control: no-store\r\n"
+        "Connection: %s\r\n"
+        "\r\n",
+        status, ctype, len, keep_alive ? "keep-alive" : "close");
+    conn_out(c,hdr,(size_t)n);
+    conn_out(c,body,len);
+    if (!keep_alive) c->closing=true;
+}
+
+typedef struct {
+    char   method[8];
+    char   path[256];
+    char   query[256];
+    bool   http11;
+    bool   keep_alive;
+    char   if_none_match[128];
+    char   if_modified_since[64];
+    const char *body;
+    size_t body_len;
+} HttpRequest;
+
+static void view_render(ViewCache *vc, int view){
+    double t0=mono_seconds();
+    OutBuf *body=&vc->body;
+    body->len=0;
+    const char *ctype="text/plain";
+    if (view==VIEW_JSON){
+        ctype="application/json";
+        write_all_tasks_json(body);
+    } else {
+        ob_puts(body, "CLI Task Manager (HTTP view)\n\n");
+        write_all_tasks_text(body);
+        ob_puts(body, "\nTip: GET /json for JSON.\n");
+    }
+
+    snprintf(vc->etag, sizeof vc->etag, "\"%016llx\"",
+             (unsigned long long)fnv1a(body->data,body->len));
+    // Recurring tasks move on with the clock, not the files: a render
+    // that expands them is as new as the render itself.
+    time_t mod = stamp_active.mtime;
+    if (stamp_removed.mtime > mod) mod = stamp_removed.mtime;
+    if (stamp_journal.mtime > mod) mod = stamp_journal.mtime;
+    if (!mod || tasks.nrules) mod = time(NULL);
+    struct tm tm;
+    gmtime_r(&mod,&tm);
+    strftime(vc->last_modified, sizeof vc->last_modified,
+             "%a, %d %b %Y %H:%M:%S GMT", &tm);
+
+    vc->head.len=0;
+    ob_printf(&vc->head,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: %s; charset=utf-8\r\n"
+        "Content-Length: %zu\r\n"
+        "Cache-Control: no-cache\r\n"
+        "ETag: %s\r\n"
+        "Last-Modified: %s\r\n",
+        ctype, body->len, vc->etag, vc->last_modified);
+    vc->generation=store_generation;
+    vc->expires = tasks.nrules ? local_midnight(time(NULL),1) : 0;
+    metric_observe(PH_RENDER, mono_seconds()-t0);
+}
+
+static bool etag_listed(const char *list, const char *etag){
+    if (strcmp(list,"*")==0) return true;
+    size_t n=strlen(etag);
+    for (const char *p=strstr(list,etag); p; p=strstr(p+1,etag))
+        if (p[n]=='\0' || p[n]==',' || p[n]==' ') return true;
+    return false;
+}
+
+// The response to req from a rendered view: 304 Not Modified (built in
+// hdr) when the client's validators match, else head + body. Fills iov
+// and returns how many entries it used.
+static int view_response(const ViewCache *vc, const HttpRequest *req,
+                         char *hdr, size_t L, struct iovec *iov){
+    bool fresh = req->if_none_match[0]
+        ? etag_listed(req->if_none_match, vc->etag)
+        : (req->if_modified_since[0] &&
+           strcmp(req->if_modified_since, vc->last_modified)==0);
+    if (fresh){
+        int n=snprintf(hdr,L,
+            "HTTP/1.1 304 Not Modified\r\n"
+            "Cache-Control: no-cache\r\n"
+            "ETag: %s\r\n"
+            "Last-Modified: %s\r\n"
+            "%s\r\n",
+            vc->etag, vc->last_modified,
+            req->keep_alive ? "" : "Connection: close\r\n");
+        iov[0].iov_base=hdr;
+        iov[0].iov_len=(size_t)n;
+        return 1;
+    }
+    static char end_keep[]="\r\n";
+    static char end_close[]="Connection: close\r\n\r\n";
+    iov[0].iov_base=vc->head.data;
+    iov[0].iov_len=vc->head.len;
+    iov[1].iov_base=req->keep_alive ? end_keep : end_close;
+    iov[1].iov_len=req->keep_alive ? sizeof end_keep - 1 : sizeof end_close - 1;
+    iov[2].iov_base=vc->body.data;
+    iov[2].iov_len=vc->body.len;
+    return 3;
+}
+
+// Filtered views: /json?… and /?… with
+//   limit=N offset=N cursor=<due>.<id> since_id=N
+//   due_after=T due_before=T include=removed
+// where T is anything parse_time_arg takes.
+// The matching window is fixed up front as a list of ids, then rendered
+// in chunks of STREAM_CHUNK bytes as the socket drains, so a large result
+// never sits in memory as one response. HTTP/1.1 clients get
+// Transfer-Encoding: chunked; HTTP/1.0 clients a close-delimited body.
+
+#define STREAM_CHUNK (16*1024)
+
+typedef struct {
+    int    id;
+    bool   removed;
+    time_t due;              // the occurrence, for recurring tasks
+} StreamRow;
+
+struct Stream {
+    StreamRow *rows;
+    size_t     n;
+    size_t     pos;
+    size_t     emitted;
+    bool       json;
+    bool       chunked;
+    DayFmt     days;
+    TaskList   archived;     // removed rows read from sealed segments
+    NamedList *list;
+};
+
+typedef struct {
+    size_t limit;            // 0 = no limit
+    size_t offset;
+    bool   have_cursor;
+    time_t cursor_due;
+    int    cursor_id;
+    int    since_id;
+    time_t due_after;        // 0 = unbounded
+    time_t due_before;
+    bool   include_removed;
+    char   text[256];        // q= for /search
+} ViewQuery;
+
+// Days past now a due_before window may reach (CLITASK_HTTP_HORIZON_DAYS).
+static size_t view_horizon = 3660;
+
+static void url_decode(char *s){
+    char *w=s;
+    for (char *r=s; *r; r++) {
+        if (*r=='+') *w++=' ';
+        else if (*r=='%' && isxdigit((unsigned char)r[1]) && isxdigit((unsigned char)r[2])) {
+            char hex[3]={r[1],r[2],0};
+            *w++=(char)strtol(hex,NULL,16);
+            r+=2;
+        } else *w++=*r;
+    }
+    *w='\0';
+}
+
+static void parse_view_query(const char *query, ViewQuery *q){
+    memset(q,0,sizeof *q);
+    char buf[512];
+    strncpy(buf,query,sizeof buf - 1);
+    buf[sizeof buf - 1]='\0';
+    char *save=NULL;
+    for (char *kv=strtok_r(buf,"&",&save); kv; kv=strtok_r(NULL,"&",&save)) {
+        char *v=strchr(kv,'=');
+        if (!v) continue;
+        *v++='\0';
+        url_decode(v);
+        if (strcmp(kv,"limit")==0) q->limit=(size_t)strtoul(v,NULL,10);
+        else if (strcmp(kv,"offset")==0) q->offset=(size_t)strtoul(v,NULL,10);
+        else if (strcmp(kv,"since_id")==0) q->since_id=atoi(v);
+        else if (strcmp(kv,"due_after")==0) q->due_after=parse_time_arg(v);
+        else if (strcmp(kv,"due_before")==0) q->due_before=parse_time_arg(v);
+        else if (strcmp(kv,"q")==0) copy_bounded(q->text,sizeof q->text,v);
+        else if (strcmp(kv,"include")==0) q->include_removed=strstr(v,"removed")!=NULL;
+        else if (strcmp(kv,"cursor")==0) {
+            long long due=0;
+            int id=0;
+            if (sscanf(v,"%lld.%d",&due,&id)==2) {
+                q->have_cursor=true;
+                q->cursor_due=(time_t)due;
+                q->cursor_id=id;
+            }
+        }
+    }
+}
+
+static bool view_match(const ViewQuery *q, const Task *t){
+    if (t->id <= q->since_id) return false;
+    if (q->due_after && (!t->due || t->due <= q->due_after)) return false;
+    if (q->due_before && (!t->due || t->due >= q->due_before)) return false;
+    if (q->have_cursor) {
+        Task key={0};
+        key.id=q->cursor_id;
+        key.due=q->cursor_due;
+        const Task *pk=&key, *pt=t;
+        if (cmp_task_ptrs(&pt,&pk) <= 0) return false;
+    }
+    return true;
+}
+
+static void stream_free(Stream *st){
+    if (!st) return;
+    st->list->streams--;
+    free(st->rows);
+    tl_free(&st->archived);
+    free(st);
+}
+
+static void http_stream_start(Conn *c, const HttpRequest *req, bool json){
+    ViewQuery q;
+    parse_view_query(req->query,&q);
+    const Task **arr;
+    Task *vals;
+    size_t n=0, nvals=0;
+    bool sorted=false, partial=false;
+    if (q.due_before) {
+        // Each recurring task yields every occurrence inside the window,
+        // so keep the window within reach.
+        time_t horizon = time(NULL) + (time_t)view_horizon * 86400;
+        if (q.due_before > horizon) q.due_before=horizon;
+    }
+    TaskList archived;
+    memset(&archived,0,sizeof archived);
+    if (strcmp(req->path,"/search")==0) {
+        // Matches from both lists; removed ones are flagged in the JSON.
+        size_t hits=0, nm=0;
+        int32_t *ids=search_query(q.text,&hits);
+        arr=(const Task**)malloc((hits ? hits : 1) * sizeof *arr);
+        vals=(Task*)malloc((tasks.nrules ? tasks.nrules : 1) * sizeof *vals);
+        if(!arr || !vals){perror("malloc"); exit(1);}
+        for (size_t i=0;i<hits;i++) {
+            const Task *t=tl_find(&tasks,ids[i]);
+            if (t) t=task_upcoming(t,vals,&nvals);
+            else {
+                trash_need();
+                t=tl_find(&trash,ids[i]);
+            }
+            if (!t) ids[nm++]=ids[i];
+            else if (view_match(&q,t)) arr[n++]=t;
+        }
+        archive_collect(ids,nm,&archived);
+        free(ids);
+    } else if (!q.include_removed) {
+        // Already in order: walk the index from the first key the cursor
+        // or due_after allows and stop once due_before is passed, or once
+        // the page and one row past it are in hand. Rows are copied, since
+        // occurrences of recurring tasks exist only here.
+        size_t want = q.limit ? q.offset + q.limit + 1 : 0;
+        size_t cap=tasks.live ? tasks.live : 1;
+        if (want && want < cap) cap=want;
+        vals=(Task*)malloc(cap * sizeof *vals);
+        if(!vals){perror("malloc"); exit(1);}
+        DueIter it;
+        time_t since = q.due_after ? q.due_after+1 : 0;
+        if (q.have_cursor) due_begin(&it, &tasks, q.cursor_due, q.cursor_id+1, since, q.due_before);
+        else due_begin(&it, &tasks, since, 0, since, q.due_before);
+        bool dated = q.due_after || q.due_before;
+        for (const Task *t; (t=due_next(&it)); ) {
+            if (dated && (!t->due || (q.due_before && t->due >= q.due_before))) break;
+            if (!view_match(&q,t)) continue;
+            if (nvals==cap) {
+                Task *v=(Task*)realloc(vals,(cap*=2) * sizeof *v);
+                if(!v){perror("realloc"); exit(1);}
+                vals=v;
+            }
+            vals[nvals++]=*t;
+            if (nvals==want) { partial=true; break; }
+        }
+        due_end(&it);
+        arr=(const Task**)malloc((nvals ? nvals : 1) * sizeof *arr);
+        if(!arr){perror("malloc"); exit(1);}
+        for (; n<nvals; n++) arr[n]=&vals[n];
+        sorted=true;
+    } else {
+        trash_need();
+        archive_load_all(&archived);
+        size_t cap=tasks.live + trash.live + archived.live;
+        arr=(const Task**)malloc((cap ? cap : 1) * sizeof *arr);
+        vals=(Task*)malloc((tasks.nrules ? tasks.nrules : 1) * sizeof *vals);
+        if(!arr || !vals){perror("malloc"); exit(1);}
+        for (size_t i=0;i<tasks.len;i++) {
+            if (!tasks.recs[i].id) continue;
+            const Task *t=task_upcoming(&tasks.recs[i],vals,&nvals);
+            if (view_match(&q,t)) arr[n++]=t;
+        }
+        for (size_t i=0;i<trash.len;i++)
+            if (trash.recs[i].id && view_match(&q,&trash.recs[i])) arr[n++]=&trash.recs[i];
+    }
+    for (size_t i=0;i<archived.len;i++)
+        if (archived.recs[i].id && view_match(&q,&archived.recs[i])) arr[n++]=&archived.recs[i];
+    const Task *trash_lo=trash.recs, *trash_hi=trash.recs + trash.len;
+    const Task *arch_lo=archived.recs, *arch_hi=archived.recs + archived.len;
+    if (!sorted) {
+        double t0=mono_seconds();
+        qsort(arr,n,sizeof *arr,cmp_task_ptrs);
+        metric_observe(PH_SORT, mono_seconds()-t0);
+    }
+
+    size_t start = q.offset < n ? q.offset : n;
+    size_t end = (q.limit && start + q.limit < n) ? start + q.limit : n;
+
+    Stream *st=(Stream*)calloc(1,sizeof *st);
+    if(!st){perror("calloc"); exit(1);}
+    st->n=end-start;
+    st->rows=(StreamRow*)malloc((st->n ? st->n : 1) * sizeof *st->rows);
+    if(!st->rows){perror("malloc"); exit(1);}
+    for (size_t i=start;i<end;i++) {
+        st->rows[i-start].id=arr[i]->id;
+        st->rows[i-start].due=arr[i]->due;
+        st->rows[i-start].removed=(arr[i]>=trash_lo && arr[i]<trash_hi) ||
+                                  (arr[i]>=arch_lo && arr[i]<arch_hi);
+    }
+    st->archived=archived;
+    st->list=cur_list;
+    st->list->streams++;
+    st->json=json;
+    st->chunked=req->http11;
+
+    // A walk cut short knows there is a next page but not how many rows
+    // the window holds, so it leaves the total out.
+    char total[48]="";
+    if (!partial) snprintf(total,sizeof total,"X-Total-Count: %zu\r\n",n);
+    char cursor[64]="";
+    if (end < n)
+        snprintf(cursor,sizeof cursor,"X-Next-Cursor: %lld.%d\r\n",
+                 (long long)arr[end-1]->due, arr[end-1]->id);
+    free(arr);
+    free(vals);
+
+    bool keep_alive = req->keep_alive && st->chunked;
+    char hdr[512];
+    int len=snprintf(hdr,sizeof hdr,
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: %s; charset=utf-8\r\n"
+        "%s"
+        "Cache-Control: no-store\r\n"
+        "%s"
+        "%s"
+        "Connection: %s\r\n"
+        "\r\n",
+        json ? "application/json" : "text/plain",
+        st->chunked ? "Transfer-Encoding: chunked\r\n" : "",
+        total, cursor, keep_alive ? "keep-alive" : "close");
+    conn_out(c,hdr,(size_t)len);
+    if (!keep_alive) c->closing=true;
+    c->stream=st;
+}
+
+// Appends the next chunk of c->stream to c->out; ends the stream after
+// the last one.
+static void stream_pump(Conn *c){
+    Stream *st=c->stream;
+    list_enter(st->list);
+    double t0=mono_seconds();
+    OutBuf chunk={0};
+    if (st->pos==0 && st->emitted==0) {
+        if (st->json) ob_puts(&chunk,"[\n");
+        else print_table_head(&chunk);
+    }
+    while (st->pos < st->n && chunk.len < STREAM_CHUNK) {
+        const StreamRow *r=&st->rows[st->pos++];
+        if (r->removed) trash_need();
+        const Task *t=tl_find(r->removed ? &trash : &tasks, r->id);
+        if (!t && r->removed) t=tl_find(&st->archived, r->id);
+        if (!t) continue;   // deleted since the window was taken
+        Task occ;
+        if (t->repeat && !r->removed) {
+            occ=*t;
+            occ.due=r->due;
+            t=&occ;
+        }
+        if (st->json) {
+            if (st->emitted) ob_puts(&chunk,",\n");
+            write_task_json(&chunk,&st->days,t,r->removed);
+        } else {
+            print_task_row(&chunk,&st->days,t);
+        }
+        st->emitted++;
+    }
+    bool done = st->pos == st->n;
+    if (done && st->json) ob_puts(&chunk, st->emitted ? "\n]\n" : "]\n");
+    metric_observe(PH_RENDER, mono_seconds()-t0);
+    if (chunk.len) {
+        if (st->chunked) {
+            char size[24];
+            int k=snprintf(size,sizeof size,"%zx\r\n",chunk.len);
+            conn_out(c,size,(size_t)k);
+        }
+        conn_out(c,chunk.data,chunk.len);
+        if (st->chunked) conn_out(c,"\r\n",2);
+    }
+    ob_free(&chunk);
+    if (done) {
+        if (st->chunked) conn_out(c,"0\r\n\r\n",5);
+        stream_free(st);
+        c->stream=NULL;
+    }
+}
+
+// Writes, on the default list or any /lists/<name>:
+//   POST /tasks                 {"description":…,"due":…,"repeat":…} or an
+//                               array of them; due as for `add`, or epoch
+//   DELETE /tasks/<id>          move a task to the removed list
+//   POST /tasks/<id>/restore    move it back
+// A request is checked when it arrives but applied later: the writes
+// queued within CLITASK_HTTP_BATCH_MS of the first one are applied
+// together, per list under one store lock, as one journal append and one
+// group commit, and each is answered once that is durable. Ids are handed
+// out then, under the lock, so they never collide with a CLI writer's.
+// A connection reads nothing more until its answer is out, which keeps
+// its responses in request order.
+
+enum { WRITE_ADD, WRITE_DELETE, WRITE_RESTORE };
+
+typedef struct {
+    Conn       *c;           // NULL once the client has gone
+    NamedList  *list;
+    int         op;
+    int         id;          // WRITE_DELETE, WRITE_RESTORE
+    Task       *adds;        // WRITE_ADD; desc is an offset into text
+    size_t      nadds, adds_cap;
+    OutBuf      text;
+    bool        array;       // the body was a JSON array
+    bool        keep_alive;
+    const char *status;      // set once applied
+    OutBuf      body;
+} PendingWrite;
+
+static PendingWrite *pending;
+static size_t n_pending, pending_cap;
+static double pending_since;     // when the oldest was queued
+
+static void writes_forget(const Conn *c){
+    for (size_t i=0;i<n_pending;i++)
+        if (pending[i].c==c) pending[i].c=NULL;
+}
+
+static void write_free(PendingWrite *w){
+    free(w->adds);
+    ob_free(&w->text);
+    ob_free(&w->body);
+}
+
+// Reads a POST /tasks body into w. Returns false with err set if any
+// task in it is invalid; then none of them is queued.
+static bool write_parse_adds(PendingWrite *w, const char *body, size_t len,
+                             char *err, size_t L){
+    char *src=(char*)malloc(len+1);
+    char *desc=(char*)malloc(len+1);
+    if(!src || !desc){perror("malloc"); exit(1);}
+    memcpy(src,body,len);
+    src[len]='\0';
+    const char *p=src;
+    while (isspace((unsigned char)*p)) p++;
+    w->array = *p=='[';
+    err[0]='\0';
+    for (size_t k=1; !err[0]; k++) {
+        char date[32]="", tm[32]="", rule[32]="";
+        time_t due=0;
+        desc[0]='\0';
+        const char *next=jsonl_parse(p,desc,len+1,date,tm,rule,sizeof date,&due);
+        if (!next) break;
+        p=next;
+        for (char *q=desc; *q; ++q) if (*q=='\n' || *q=='\r') *q=' ';
+        Task t={0};
+        const char *bad = desc[0] ? task_fields(date,tm,rule,due,&t) : "missing description";
+        if (bad) {
+            snprintf(err,L,"Task %zu: %s\n",k,bad);
+            break;
+        }
+        if (w->nadds==w->adds_cap) {
+            w->adds_cap = w->adds_cap ? w->adds_cap*2 : 4;
+            Task *a=(Task*)realloc(w->adds, w->adds_cap * sizeof *a);
+            if(!a){perror("realloc"); exit(1);}
+            w->adds=a;
+        }
+        t.len=(uint32_t)strlen(desc);
+        t.desc=(uint32_t)w->text.len;
+        ob_put(&w->text,desc,(size_t)t.len+1);
+        w->adds[w->nadds++]=t;
+        if (!w->array) break;
+    }
+    if (!err[0] && !w->nadds) snprintf(err,L,"No task in body\n");
+    free(src);
+    free(desc);
+    return !err[0];
+}
+
+// Checks a /tasks request and queues it, or answers it right away if it
+// is malformed.
+static void http_write(Conn *c, const HttpRequest *req, NamedList *l){
+    PendingWrite w;
+    memset(&w,0,sizeof w);
+    const char *rest=req->path+6;
+    bool post = strcmp(req->method,"POST")==0;
+    char err[96];
+    if (!*rest) {
+        if (!post) {
+            const char msg[]="Method Not Allowed\n";
+            http_respond(c, "405 Method Not Allowed", "text/plain", msg, sizeof msg - 1,
+                         req->keep_alive);
+            return;
+        }
+        w.op=WRITE_ADD;
+        if (!write_parse_adds(&w, req->body, req->body_len, err, sizeof err)) {
+            http_respond(c, "400 Bad Request", "text/plain", err, strlen(err),
+                         req->keep_alive);
+            write_free(&w);
+            return;
+        }
+    } else {
+        char num[16];
+        size_t n=strcspn(rest+1,"/");
+        snprintf(num, sizeof num, "%.*s", (int)n, rest+1);
+        const char *tail=rest+1+n;
+        if (parseInt(num,&w.id)!=0 || w.id<=0 || (*tail && strcmp(tail,"/restore")!=0)) {
+            const char msg[]="Not Found\n";
+            http_respond(c, "404 Not Found", "text/plain", msg, sizeof msg - 1,
+                         req->keep_alive);
+            return;
+        }
+        if (*tail ? !post : strcmp(req->method,"DELETE")!=0) {
+            const char msg[]="Method Not Allowed\n";
+            http_respond(c, "405 Method Not Allowed", "text/plain", msg, sizeof msg - 1,
+                         req->keep_alive);
+            return;
+        }
+        w.op = *tail ? WRITE_RESTORE : WRITE_DELETE;
+    }
+    w.c=c;
+    w.list=l;
+    w.keep_alive=req->keep_alive;
+    if (n_pending==pending_cap) {
+        pending_cap = pending_cap ? pending_cap*2 : 16;
+        PendingWrite *p=(PendingWrite*)realloc(pending, pending_cap * sizeof *p);
+        if(!p){perror("realloc"); exit(1);}
+        pending=p;
+    }
+    if (!n_pending) pending_since=mono_seconds();
+    pending[n_pending++]=w;
+    c->queued=true;
+}
+
+// Applies w to the current list, appending its journal records to rec
+// and its answer to w->body.
+static void write_apply(PendingWrite *w, OutBuf *rec){
+    DayFmt days={0};
+    Task t;
+    char buf[32];
+    int n;
+    switch (w->op) {
+    case WRITE_ADD:
+        if (w->array) ob_puts(&w->body, "[\n");
+        for (size_t i=0;i<w->nadds;i++) {
+            t=w->adds[i];
+            t.id=nextId++;
+            t.desc=str_put(&strs, w->text.data + t.desc, t.len);
+            tl_push(&tasks,t);
+            ob_reserve(rec,t.len + JOURNAL_ADD_EXTRA);
+            n=journal_format_add(rec->data + rec->len, rec->cap - rec->len, &t);
+            if (n>0) rec->len+=(size_t)n;
+            if (i) ob_puts(&w->body, ",\n");
+            write_task_json(&w->body, &days, &t, false);
+        }
+        ob_puts(&w->body, w->array ? "\n]\n" : "\n");
+        w->status="201 Created";
+        return;
+    case WRITE_DELETE:
+        if (!tl_remove(&tasks,w->id,&t)) {
+            ob_printf(&w->body, "Task %d not found.\n", w->id);
+            w->status="404 Not Found";
+            return;
+        }
+        tl_push(&trash,t);
+        n=journal_format_delete(buf,sizeof buf,w->id);
+        ob_put(rec,buf,(size_t)n);
+        write_task_json(&w->body, &days, &t, true);
+        break;
+    default:
+        if (tl_find(&tasks,w->id)) {
+            ob_printf(&w->body, "Task %d is not removed.\n", w->id);
+            w->status="409 Conflict";
+            return;
+        }
+        trash_need();
+        if (!tl_remove(&trash,w->id,&t)) {
+            ob_printf(&w->body, "Task %d not found (archived tasks cannot be restored).\n",
+                      w->id);
+            w->status="404 Not Found";
+            return;
+        }
+        tl_push(&tasks,t);
+        n=journal_format_restore(buf,sizeof buf,w->id);
+        ob_put(rec,buf,(size_t)n);
+        write_task_json(&w->body, &days, &t, false);
+        break;
+    }
+    ob_putc(&w->body, '\n');
+    w->status="200 OK";
+}
+
+static void http_route(Conn *c, const HttpRequest *req){
+    if (strcmp(req->path, "/metrics")==0) {
+        OutBuf body={0};
+        list_enter(&default_list);
+        write_metrics(&body);
+        http_respond(c, "200 OK", "text/plain; version=0.0.4",
+                     body.data, body.len, req->keep_alive);
+        ob_free(&body);
+        return;
+    }
+    if (strcmp(req->path, "/lists")==0) {
+        OutBuf body={0};
+        write_list_names_json(&body);
+        http_respond(c, "200 OK", "application/json",
+                     body.data, body.len, req->keep_alive);
+        ob_free(&body);
+        return;
+    }
+    // /lists/<name>/<view> is <view> on that list.
+    NamedList *l=&default_list;
+    HttpRequest sub;
+    if (strncmp(req->path, "/lists/", 7)==0) {
+        const char *name=req->path+7;
+        size_t n=strcspn(name, "/");
+        l=list_find(name, n);
+        if (!l) {
+            const char msg[]="No such list\n";
+            http_respond(c, "404 Not Found", "text/plain", msg, sizeof msg - 1,
+                         req->keep_alive);
+            return;
+        }
+        sub=*req;
+        snprintf(sub.path, sizeof sub.path, "/%s", name[n] ? name+n+1 : "");
+        req=&sub;
+    }
+    if (strcmp(req->path, "/tasks")==0 || strncmp(req->path, "/tasks/", 7)==0) {
+        l->last_used=time(NULL);
+        http_write(c, req, l);
+        return;
+    }
+    list_enter(l);
+    l->last_used=time(NULL);
+    store_refresh();
+    if (!l->streams) str_maybe_compact();
+    int view = strcmp(req->path, "/json")==0 ? VIEW_JSON : VIEW_TEXT;
+    bool search = strcmp(req->path, "/search")==0;
+    if (req->query[0] || search) {
+        http_stream_start(c, req, view==VIEW_JSON || search);
+        return;
+    }
+    ViewCache *vc=&view_cache[view];
+    if (vc->generation != store_generation ||
+        (vc->expires && time(NULL) >= vc->expires))
+        view_render(vc, view);
+    char hdr[256];
+    struct iovec iov[3];
+    conn_send_iov(c, iov, view_response(vc, req, hdr, sizeof hdr, iov));
+    if (!req->keep_alive) c->closing=true;
+}
+
+static const char *find_header_end(const char *buf, size_t len){
+    for (size_t i=0;i+3<len;i++)
+        if (buf[i]=='\r' && buf[i+1]=='\n' && buf[i+2]=='\r' && buf[i+3]=='\n')
+            return buf+i+4;
+    return NULL;
+}
+
+static void header_value(const char *v, char *out, size_t L){
+    while (*v==' ' || *v=='\t') v++;
+    size_t n=strcspn(v,"\r\n");
+    while (n && (v[n-1]==' ' || v[n-1]=='\t')) n--;
+    if (n >= L) n = L-1;
+    memcpy(out,v,n);
+    out[n]='\0';
+}
+
+enum { HTTP_PARTIAL, HTTP_READY, HTTP_BAD, HTTP_HEAD_TOO_LARGE, HTTP_BODY_TOO_LARGE };
+
+// Parses the first request in c->in into req; on HTTP_READY, *used is
+// its length with the body.
+static int http_parse(const Conn *c, HttpRequest *req, size_t *used){
+    const char *end=find_header_end(c->in,c->in_len);
+    if (!end) return c->in_len == sizeof c->in ? HTTP_HEAD_TOO_LARGE : HTTP_PARTIAL;
+    size_t hdr_len=(size_t)(end - c->in);
+    char head_buf[HTTP_REQ_MAX+1];
+    memcpy(head_buf,c->in,hdr_len);
+    head_buf[hdr_len]='\0';
+    memset(req,0,sizeof *req);
+    int major=1, minor=0;
+    if (sscanf(head_buf, "%7s %255s HTTP/%d.%d", req->method, req->path, &major, &minor) < 2)
+        return HTTP_BAD;
+    req->http11 = (major==1 && minor>=1);
+    req->keep_alive = req->http11;
+    char *qs=strchr(req->path,'?');
+    if (qs) {
+        *qs++='\0';
+        strncpy(req->query, qs, sizeof req->query - 1);
+    }
+    for (char *line=strstr(head_buf,"\r\n"); line && line[2]; line=strstr(line+2,"\r\n")) {
+        const char *h=line+2;
+        if (strncasecmp(h,"connection:",11)==0) {
+            const char *v=h+11;
+            while (*v==' ') v++;
+            if (strncasecmp(v,"close",5)==0) req->keep_alive=false;
+            else if (strncasecmp(v,"keep-alive",10)==0) req->keep_alive=true;
+        } else if (strncasecmp(h,"content-length:",15)==0) {
+            // Digits only: strtoull would take a sign and wrap "-1".
+            const char *v=h+15;
+            while (*v==' ' || *v=='\t') v++;
+            if (*v<'0' || *v>'9') return HTTP_BAD;
+            char *e;
+            errno=0;
+            unsigned long long n=strtoull(v,&e,10);
+            while (*e==' ' || *e=='\t') e++;
+            if (*e!='\r' && *e!='\0') return HTTP_BAD;
+            if (errno || n > sizeof c->in) return HTTP_BODY_TOO_LARGE;
+            req->body_len=(size_t)n;
+        } else if (strncasecmp(h,"if-none-match:",14)==0) {
+            header_value(h+14, req->if_none_match, sizeof req->if_none_match);
+        } else if (strncasecmp(h,"if-modified-since:",18)==0) {
+            header_value(h+18, req->if_modified_since, sizeof req->if_modified_since);
+        }
+    }
+    if (req->body_len > sizeof c->in - hdr_len) return HTTP_BODY_TOO_LARGE;
+    if (hdr_len + req->body_len > c->in_len) return HTTP_PARTIAL;   // body still arriving
+    req->body = c->in + hdr_len;
+    *used = hdr_len + req->body_len;
+    return HTTP_READY;
+}
+
+// Handles every complete request in c->in.
+static void http_process(Conn *c){
+    while (!c->closing && !c->stream && !c->queued) {
+        HttpRequest req;
+        size_t used=0;
+        int st=http_parse(c,&req,&used);
+        if (st==HTTP_PARTIAL) return;
+        if (st==HTTP_HEAD_TOO_LARGE) {
+            const char msg[]="Request Too Large\n";
+            http_respond(c,"431 Request Header Fields Too Large","text/plain",
+                         msg,sizeof msg - 1,false);
+            return;
+        }
+        if (st==HTTP_BAD) {
+            const char msg[]="Bad Request\n";
+            http_respond(c,"400 Bad Request","text/plain",msg,sizeof msg - 1,false);
+            return;
+        }
+        if (st==HTTP_BODY_TOO_LARGE) {
+            const char msg[]="Payload Too Large\n";
+            http_respond(c,"413 Payload Too Large","text/plain",msg,sizeof msg - 1,false);
+            return;
+        }
+        double t0=mono_seconds();
+        http_route(c, &req);
+        metrics.requests++;
+        metric_observe(PH_REQUEST, mono_seconds()-t0);
+        memmove(c->in, c->in + used, c->in_len - used);
+        c->in_len-=used;
+    }
+}
+
+// Writes as much of c->out as the socket takes. False if c was closed.
+// Streams render their next chunk only once the previous one is out, and
+// requests pipelined behind a stream are picked up when it ends.
+static bool conn_flush(Conn *c){
+    for (;;) {
+        while (c->out_off < c->out.len) {
+            double t0=mono_seconds();
+            ssize_t w=write(c->fd, c->out.data + c->out_off, c->out.len - c->out_off);
+            metric_observe(PH_WRITE, mono_seconds()-t0);
+            if (w<0) {
+                if (errno==EINTR) continue;
+                if (errno==EAGAIN || errno==EWOULDBLOCK) {
+                    ev_mod(c->fd, c->queued || c->eof ? EV_OUT : EV_IN|EV_OUT);
+                    return true;
+                }
+                conn_close(c);
+                return false;
+            }
+            c->out_off+=(size_t)w;
+            metrics.bytes_written+=(uint64_t)w;
+            c->last_active=time(NULL);
+        }
+        c->out_off=c->out.len=0;
+        if (c->stream) {
+            stream_pump(c);
+            if (!c->stream && c->in_len && !c->closing) http_process(c);
+            continue;
+        }
+        break;
+    }
+    if (c->closing || (c->eof && !c->queued)) { conn_close(c); return false; }
+    ev_mod(c->fd, c->queued ? 0 : EV_IN);
+    return true;
+}
+
+// A client that half-closes after its requests still gets its answers:
+// EOF only marks the connection, which closes once they are out.
+static void conn_on_readable(Conn *c){
+    for (;;) {
+        if (c->in_len == sizeof c->in) break;
+        ssize_t n=read(c->fd, c->in + c->in_len, sizeof c->in - c->in_len);
+        if (n==0) { c->eof=true; break; }
+        if (n<0) {
+            if (errno==EINTR) continue;
+            if (errno==EAGAIN || errno==EWOULDBLOCK) break;
+            conn_close(c);
+            return;
+        }
+        c->in_len+=(size_t)n;
+    }
+    c->last_active=time(NULL);
+    http_process(c);
+    conn_flush(c);
+}
+
+// Answers every write to l in batch[0..n) with a 500.
+static void writes_fail(PendingWrite *batch, size_t n, const NamedList *l, const char *msg){
+    for (size_t j=0;j<n;j++) {
+        if (batch[j].list!=l) continue;
+        batch[j].body.len=0;
+        ob_puts(&batch[j].body, msg);
+        batch[j].status="500 Internal Server Error";
+    }
+}
+
+// Applies the queued writes, per list under one store lock with one
+// journal append and one group commit, then answers them. If the store
+// could not be read, or the append fails (the list is then reloaded from
+// disk, dropping that batch), every write to that list gets a 500.
+static void writes_flush(void){
+    if (!n_pending) return;
+    PendingWrite *batch=pending;
+    size_t n=n_pending;
+    pending=NULL;
+    n_pending=pending_cap=0;
+    for (size_t i=0;i<n;i++) {
+        if (batch[i].status) continue;
+        NamedList *l=batch[i].list;
+        list_enter(l);
+        if (!store_begin()) {
+            writes_fail(batch+i, n-i, l, "Store could not be read\n");
+            continue;
+        }
+        OutBuf rec={0};
+        int first=nextId;
+        for (size_t j=i;j<n;j++)
+            if (batch[j].list==l) write_apply(&batch[j],&rec);
+        if (rec.len && !journal_write(rec.data,rec.len)) {
+            reload_all_from_disk();
+            writes_fail(batch+i, n-i, l, "Write failed\n");
+        } else if (rec.len) {
+            search_note_adds(first);
+            store_maybe_compact();
+        }
+        store_end();
+        ob_free(&rec);
+        metrics.write_batches++;
+    }
+    for (size_t i=0;i<n;i++) {
+        PendingWrite *w=&batch[i];
+        Conn *c=w->c;
+        if (c) {
+            c->queued=false;
+            http_respond(c, w->status,
+                         w->status[0]=='2' ? "application/json" : "text/plain",
+                         w->body.data, w->body.len, w->keep_alive);
+            http_process(c);
+            conn_flush(c);
+        }
+        write_free(w);
+    }
+    free(batch);
+    metrics.writes+=n;
+}
+
+static void set_nonblocking(int fd){
+    int fl=fcntl(fd,F_GETFL,0);
+    if (fl>=0) fcntl(fd,F_SETFL,fl|O_NONBLOCK);
+}
+
+// Threaded serve. The main thread stays the loader: it accepts, watches
+// the store, and runs everything that touches the lists. A connection
+// with a request waiting is handed to a worker over a pipe (whole
+// pointers, so no other queue is needed), and the worker answers GET /
+// and /json of the default list from the published Snapshot: immutable
+// renders of both views, reference-counted. Anything else, and the
+// connection itself once it has nothing more to read, goes back to the
+// main loop. Views can lag a write by the time the loader takes to
+// notice it, which inotify keeps short.
+//
+// Publishing swaps snap_current atomically. Workers never lock: they bump
+// their epoch to odd, load the pointer, take a reference, and bump it
+// back to even. The loader drops its own reference to a replaced
+// snapshot only after every worker has been seen even or has moved on
+// since the swap (a grace period); the last reference frees it.
+
+#define HTTP_MAX_THREADS 64
+
+typedef struct {
+    unsigned long refs;
+    ViewCache     views[VIEW_COUNT];
+} Snapshot;
+
+typedef struct Retired {
+    Snapshot       *snap;
+    unsigned long  *epochs;      // per worker, when it was replaced
+    struct Retired *next;
+} Retired;
+
+static Snapshot *snap_current;
+static Retired *snap_retired;
+static int pool_in[2] = {-1, -1};    // main -> workers
+static int pool_out[2] = {-1, -1};   // workers -> main
+
+static void snap_release(Snapshot *s){
+    if (__atomic_sub_fetch(&s->refs, 1, __ATOMIC_ACQ_REL)) return;
+    for (int v=0;v<VIEW_COUNT;v++) {
+        ob_free(&s->views[v].head);
+        ob_free(&s->views[v].body);
+    }
+    free(s);
+}
+
+static Snapshot *snap_acquire(Worker *w){
+    __atomic_add_fetch(&w->epoch, 1, __ATOMIC_SEQ_CST);
+    Snapshot *s=__atomic_load_n(&snap_current, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&s->refs, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&w->epoch, 1, __ATOMIC_SEQ_CST);
+    return s;
+}
+
+// Releases replaced snapshots whose grace period is over.
+static void snap_reclaim(void){
+    for (Retired **p=&snap_retired; *p; ) {
+        Retired *r=*p;
+        bool done=true;
+        for (int i=0;i<n_workers && done;i++) {
+            unsigned long e=__atomic_load_n(&workers[i].epoch, __ATOMIC_SEQ_CST);
+            done = (r->epochs[i] & 1)==0 || e != r->epochs[i];
+        }
+        if (!done) { p=&r->next; continue; }
+        *p=r->next;
+        snap_release(r->snap);
+        free(r->epochs);
+        free(r);
+    }
+}
+
+// Brings the default list up to date and publishes fresh renders of it
+// if they changed (or recurring tasks moved on at midnight).
+static void snap_maybe_publish(void){
+    list_enter(&default_list);
+    default_list.last_used=time(NULL);
+    store_refresh();
+    if (!default_list.streams) str_maybe_compact();
+    Snapshot *old=snap_current;
+    if (old && old->views[0].generation==store_generation &&
+        !(old->views[0].expires && time(NULL) >= old->views[0].expires)) {
+        snap_reclaim();
+        return;
+    }
+    Snapshot *s=(Snapshot*)calloc(1,sizeof *s);
+    if(!s){perror("calloc"); exit(1);}
+    s->refs=1;
+    for (int v=0;v<VIEW_COUNT;v++) view_render(&s->views[v], v);
+    __atomic_store_n(&snap_current, s, __ATOMIC_SEQ_CST);
+    if (old) {
+        Retired *r=(Retired*)malloc(sizeof *r);
+        unsigned long *e=(unsigned long*)malloc((n_workers ? n_workers : 1) * sizeof *e);
+        if(!r || !e){perror("malloc"); exit(1);}
+        for (int i=0;i<n_workers;i++) e[i]=__atomic_load_n(&workers[i].epoch, __ATOMIC_SEQ_CST);
+        r->snap=old;
+        r->epochs=e;
+        r->next=snap_retired;
+        snap_retired=r;
+    }
+    snap_reclaim();
+}
+
+// writev until everything is out, waiting up to timeout_ms whenever the
+// socket is full. Returns the bytes written; short on error or timeout.
+static size_t send_iov_all(int fd, struct iovec *iov, int cnt, int timeout_ms){
+    size_t total=0;
+    while (cnt) {
+        ssize_t w=writev(fd, iov, cnt);
+        if (w<0) {
+            if (errno==EINTR) continue;
+            if (errno!=EAGAIN && errno!=EWOULDBLOCK) break;
+            struct pollfd pf={fd, POLLOUT, 0};
+            if (poll(&pf, 1, timeout_ms) <= 0) break;
+            continue;
+        }
+        total+=(size_t)w;
+        size_t left=(size_t)w;
+        while (cnt && left >= iov->iov_len) { left-=iov->iov_len; iov++; cnt--; }
+        if (cnt) {
+            iov->iov_base=(char*)iov->iov_base + left;
+            iov->iov_len-=left;
+        }
+    }
+    return total;
+}
+
+// Reads what c has sent and answers requests from the snapshot for as
+// long as they are ones it can answer. EOF is left for the main loop to
+// act on, after whatever is still buffered.
+static void worker_serve(Worker *w, Conn *c, int timeout_ms){
+    for (;;) {
+        if (c->in_len == sizeof c->in) break;
+        ssize_t n=read(c->fd, c->in + c->in_len, sizeof c->in - c->in_len);
+        if (n==0) { c->eof=true; break; }
+        if (n<0) {
+            if (errno==EINTR) continue;
+            if (errno==EAGAIN || errno==EWOULDBLOCK) break;
+            c->closing=true;
+            return;
+        }
+        c->in_len+=(size_t)n;
+    }
+    c->last_active=time(NULL);
+    for (;;) {
+        HttpRequest req;
+        size_t used=0;
+        if (http_parse(c,&req,&used) != HTTP_READY || req.query[0]) return;
+        int view;
+        if (strcmp(req.path,"/")==0) view=VIEW_TEXT;
+        else if (strcmp(req.path,"/json")==0) view=VIEW_JSON;
+        else return;
+        double t0=mono_seconds();
+        Snapshot *s=snap_acquire(w);
+        char hdr[256];
+        struct iovec iov[3];
+        int cnt=view_response(&s->views[view], &req, hdr, sizeof hdr, iov);
+        size_t want=0;
+        for (int i=0;i<cnt;i++) want+=iov[i].iov_len;
+        double t1=mono_seconds();
+        size_t sent=send_iov_all(c->fd, iov, cnt, timeout_ms);
+        double t2=mono_seconds();
+        snap_release(s);
+        pthread_mutex_lock(&w->mu);
+        w->requests++;
+        w->bytes_written+=sent;
+        hist_observe(&w->write, t2-t1);
+        hist_observe(&w->request, t2-t0);
+        pthread_mutex_unlock(&w->mu);
+        memmove(c->in, c->in + used, c->in_len - used);
+        c->in_len-=used;
+        c->last_active=time(NULL);
+        if (sent < want || !req.keep_alive) { c->closing=true; return; }
+    }
+}
+
+typedef struct {
+    Worker *w;
+    int     timeout_ms;
+} WorkerArg;
+
+static void *worker_main(void *arg){
+    WorkerArg *a=(WorkerArg*)arg;
+    for (;;) {
+        Conn *c;
+        ssize_t n=read(pool_in[0], &c, sizeof c);
+        if (n<0 && errno==EINTR) continue;
+        if (n!=(ssize_t)sizeof c || !c) break;
+        worker_serve(a->w, c, a->timeout_ms);
+        while (write(pool_out[1], &c, sizeof c) < 0 && errno==EINTR) {}
+    }
+    free(a);
+    return NULL;
+}
+
+// Starts n workers with SIGINT blocked, so Ctrl+C reaches the main loop.
+static bool pool_start(int n, int timeout_ms){
+    if (pipe(pool_in)!=0 || pipe(pool_out)!=0) { perror("pipe"); return false; }
+    fcntl(pool_in[0], F_SETFD, FD_CLOEXEC);
+    fcntl(pool_in[1], F_SETFD, FD_CLOEXEC);
+    fcntl(pool_out[0], F_SETFD, FD_CLOEXEC);
+    fcntl(pool_out[1], F_SETFD, FD_CLOEXEC);
+    set_nonblocking(pool_out[0]);
+    workers=(Worker*)calloc((size_t)n, sizeof *workers);
+    if(!workers){perror("calloc"); exit(1);}
+    snap_maybe_publish();
+    sigset_t block, old;
+    sigemptyset(&block);
+    sigaddset(&block, SIGINT);
+    pthread_sigmask(SIG_BLOCK, &block, &old);
+    for (int i=0;i<n;i++) {
+        pthread_mutex_init(&workers[i].mu, NULL);
+        WorkerArg *a=(WorkerArg*)malloc(sizeof *a);
+        if(!a){perror("malloc"); exit(1);}
+        a->w=&workers[i];
+        a->timeout_ms=timeout_ms;
+        if (pthread_create(&workers[i].tid, NULL, worker_main, a)!=0) {
+            free(a);
+            break;
+        }
+        n_workers++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old, NULL);
+    return n_workers > 0;
+}
+
+// Takes back connections the workers are done with.
+static void pool_collect(void){
+    Conn *c;
+    while (read(pool_out[0], &c, sizeof c) == (ssize_t)sizeof c) {
+        c->busy=false;
+        if (c->closing) { conn_close(c); continue; }
+        ev_add(c->fd, EV_IN);
+        http_process(c);
+        conn_flush(c);
+    }
+}
+
+static void pool_stop(void){
+    Conn *none=NULL;
+    for (int i=0;i<n_workers;i++)
+        while (write(pool_in[1], &none, sizeof none) < 0 && errno==EINTR) {}
+    for (int i=0;i<n_workers;i++) {
+        pthread_join(workers[i].tid, NULL);
+        pthread_mutex_destroy(&workers[i].mu);
+    }
+    while (snap_retired) {
+        Retired *r=snap_retired;
+        snap_retired=r->next;
+        snap_release(r->snap);
+        free(r->epochs);
+        free(r);
+    }
+    if (snap_current) snap_release(snap_current);
+    snap_current=NULL;
+    free(workers);
+    workers=NULL;
+    n_workers=0;
+    for (int k=0;k<2;k++) {
+        close(pool_in[k]);
+        close(pool_out[k]);
+        pool_in[k]=pool_out[k]=-1;
+    }
+}
+
+static void cmd_serve(int argc, char **argv){
+    if (argc < 1){
+        printf("Usage: serve <port>\n");
+        return;
+    }
+    int port=0;
+    if(parseInt(argv[0], &port)!=0 || port<=0 || port>65535){
+        printf("Invalid port.\n");
+        return;
+    }
+    int s = socket(AF_INET, SOCK_STREAM, 0);
+    if (s < 0){ perror("socket"); return; }
+    int one=1;
+    setsockopt(s, SOL_SOCKET, SO_REUSEADDR, &one, sizeof one);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons((unsigned short)port);
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (bind(s, (struct sockaddr*)&addr, sizeof addr) < 0){
+        perror("bind"); close(s); return;
+    }
+    if (listen(s, SOMAXCONN) < 0){
+        perror("listen"); close(s); return;
+    }
+    if (!ev_init()){
+        perror("epoll_create"); close(s); return;
+    }
+    set_nonblocking(s);
+    ev_add(s, EV_IN);
+    signal(SIGINT, handle_sigint);
+    signal(SIGPIPE, SIG_IGN);
+    metrics.started = time(NULL);
+    change_watch_init();
+    time_t idle = (time_t)env_limit("CLITASK_HTTP_IDLE", 15);
+    time_t list_idle = (time_t)env_limit("CLITASK_LIST_IDLE", 300);
+    time_t last_sweep = time(NULL);
+    double batch = (double)env_limit("CLITASK_HTTP_BATCH_MS", 5) / 1000.0;
+    view_horizon = env_limit("CLITASK_HTTP_HORIZON_DAYS", view_horizon);
+    size_t threads = env_limit("CLITASK_HTTP_THREADS", 0);
+    if (threads > HTTP_MAX_THREADS) threads = HTTP_MAX_THREADS;
+    if (threads && pool_start((int)threads, (int)idle*1000)) {
+        ev_add(pool_out[0], EV_IN);
+        if (change_fd >= 0) ev_add(change_fd, EV_IN);
+    }
+    if (n_workers)
+        printf("%sServing%s on http://127.0.0.1:%d with %d worker thread%s (Ctrl+C to stop)\n",
+               C_BLUE(), S_RESET(), port, n_workers, n_workers==1 ? "" : "s");
+    else
+        printf("%sServing%s on http://127.0.0.1:%d (Ctrl+C to stop)\n",
+               C_BLUE(), S_RESET(), port);
+    fflush(stdout);
+    while (srv_running){
+        Event evs[64];
+        int timeout = 1000;
+        if (n_pending) {
+            double left = pending_since + batch - mono_seconds();
+            timeout = left > 0 ? (int)(left*1000.0) + 1 : 0;
+        }
+        int n = ev_wait(evs, 64, timeout);
+        if (n < 0 && errno != EINTR){ perror("wait"); break; }
+        for (int i=0; i<n; i++){
+            if (n_workers && evs[i].fd == pool_out[0]){
+                pool_collect();
+                continue;
+            }
+            if (n_workers && evs[i].fd == change_fd) continue;
+            if (evs[i].fd == s){
+                for (;;){
+                    int c = accept(s, NULL, NULL);
+                    if (c < 0) break;
+                    set_nonblocking(c);
+                    conn_new(c);
+                    metrics.connections++;
+                    ev_add(c, EV_IN);
+                }
+                continue;
+            }
+            Conn *c = ((size_t)evs[i].fd < conns_cap) ? conns[evs[i].fd] : NULL;
+            if (!c || c->busy) continue;
+            if (evs[i].events & EV_OUT){
+                if (!conn_flush(c)) continue;
+            }
+            if (!(evs[i].events & EV_IN) || c->queued) continue;
+            if (n_workers && !c->stream && c->out_off == c->out.len) {
+                ev_del(c->fd);
+                c->busy=true;
+                while (write(pool_in[1], &c, sizeof c) < 0 && errno==EINTR) {}
+            } else {
+                conn_on_readable(c);
+            }
+        }
+        if (n_pending && mono_seconds() - pending_since >= batch) writes_flush();
+        if (n_workers) snap_maybe_publish();
+        time_t now = time(NULL);
+        if (now != last_sweep){
+            last_sweep = now;
+            for (size_t fd=0; fd<conns_cap; fd++)
+                if (conns[fd] && !conns[fd]->busy && !conns[fd]->queued &&
+                    now - conns[fd]->last_active >= idle)
+                    conn_close(conns[fd]);
+            lists_evict(now, list_idle);
+        }
+    }
+    writes_flush();
+    if (n_workers) pool_stop();
+    for (size_t fd=0; fd<conns_cap; fd++)
+        if (conns[fd]) conn_close(conns[fd]);
+    ev_close();
+    close(s);
+    printf("\nServer stopped.\n");
+}
+
+static uint64_t occ_key(const Task *t){
+    return (uint32_t)t->id | (uint64_t)(uint32_t)t->due << 32;
+}
+
+static size_t idset_bucket(uint64_t key, size_t mask){
+    return ((uint32_t)(key ^ key>>32) * 2654435761u) & mask;
+}
+
+static bool idset_has(const IdSet *set, uint64_t key){
+    if (!set->cap) return false;
+    size_t mask=set->cap - 1;
+    for (size_t b=idset_bucket(key,mask); set->slots[b]; b=(b+1)&mask)
+        if (set->slots[b]==key) return true;
+    return false;
+}
+
+static void idset_add(IdSet *set, uint64_t key){
+    if ((set->len+1)*2 > set->cap) {
+        IdSet grown={0};
+        grown.cap = set->cap ? set->cap*2 : 64;
+        grown.slots=(uint64_t*)calloc(grown.cap, sizeof *grown.slots);
+        if(!grown.slots){perror("calloc"); exit(1);}
+        for (size_t i=0;i<set->cap;i++)
+            if (set->slots[i]) idset_add(&grown, set->slots[i]);
+        free(set->slots);
+        *set=grown;
+    }
+    size_t mask=set->cap - 1;
+    size_t b=idset_bucket(key,mask);
+    for (; set->slots[b]; b=(b+1)&mask)
+        if (set->slots[b]==key) return;
+    set->slots[b]=key;
+    set->len++;
+}
+
+// Keeps only the keys of occurrences due at or after `from`.
+static void idset_prune(IdSet *set, time_t from){
+    IdSet kept={0};
+    for (size_t i=0;i<set->cap;i++)
+        if (set->slots[i] && (time_t)(set->slots[i]>>32) >= from)
+            idset_add(&kept, set->slots[i]);
+    free(set->slots);
+    *set=kept;
+}
+
+// Notification dispatcher. Each notifier command (watch args, several
+// separated by "--") runs via posix_spawnp with the reminder text as its
+// last argument; there is no shell. Per notifier: at most
+// CLITASK_NOTIFY_CONCURRENCY children at once, killed after
+// CLITASK_NOTIFY_TIMEOUT seconds, and with CLITASK_NOTIFY_BATCH=1 all
+// reminders queued in one tick go to a single invocation. The scan loop
+// only queues and reaps; SIGCHLD wakes it through a self-pipe.
+
+#define NOTIFY_BATCH_MAX 64
+#define NOTIFY_KILL_GRACE 2.0
+
+typedef struct {
+    pid_t  pid;
+    double started;
+    bool   term_sent;
+} NotifyRun;
+
+typedef struct {
+    char     **argv;         // command, NULL-terminated
+    int        argc;
+    char     **queue;        // reminder texts, FIFO
+    size_t     qhead, qlen, qcap;
+    NotifyRun *run;
+    int        nrun;
+} Notifier;
+
+static Notifier *notifiers;
+static int n_notifiers;
+static int notify_limit, notify_timeout;
+static bool notify_batch;
+static int chld_pipe[2] = {-1, -1};
+
+static void handle_sigchld(int sig){
+    (void)sig;
+    int saved=errno;
+    if (chld_pipe[1] >= 0) (void)!write(chld_pipe[1], "", 1);
+    errno=saved;
+}
+
+static void notify_init(int argc, char **argv){
+    notify_limit=(int)env_limit("CLITASK_NOTIFY_CONCURRENCY", 4);
+    notify_timeout=(int)env_limit("CLITASK_NOTIFY_TIMEOUT", 30);
+    const char *b=getenv("CLITASK_NOTIFY_BATCH");
+    notify_batch = b && strcmp(b,"1")==0;
+    for (int i=0; i<argc; ) {
+        int j=i;
+        while (j<argc && strcmp(argv[j],"--")!=0) j++;
+        if (j>i) {
+            Notifier *p=(Notifier*)realloc(notifiers,(size_t)(n_notifiers+1) * sizeof *p);
+            if(!p){perror("realloc"); exit(1);}
+            notifiers=p;
+            Notifier *nt=&notifiers[n_notifiers++];
+            memset(nt,0,sizeof *nt);
+            nt->argc=j-i;
+            nt->argv=(char**)calloc((size_t)nt->argc+1,sizeof *nt->argv);
+            nt->run=(NotifyRun*)calloc((size_t)notify_limit,sizeof *nt->run);
+            if(!nt->argv || !nt->run){perror("calloc"); exit(1);}
+            for (int k=0;k<nt->argc;k++) nt->argv[k]=argv[i+k];
+        }
+        i=j+1;
+    }
+    if (!n_notifiers || pipe(chld_pipe)!=0) return;
+    for (int k=0;k<2;k++) {
+        fcntl(chld_pipe[k], F_SETFL, fcntl(chld_pipe[k], F_GETFL) | O_NONBLOCK);
+        fcntl(chld_pipe[k], F_SETFD, FD_CLOEXEC);
+    }
+    struct sigaction act;
+    memset(&act,0,sizeof act);
+    act.sa_handler=handle_sigchld;
+    act.sa_flags=SA_RESTART|SA_NOCLDSTOP;
+    sigaction(SIGCHLD, &act, NULL);
+}
+
+// Queues a reminder; without notifiers it is printed right away.
+static void notify_task(const Task *t){
+    char when[32];
+    fmt_when(t->due, when, sizeof when);
+    const char *list = cur_list->name ? cur_list->name : "";
+    const char *sep = cur_list->name ? " " : "";
+    if (!n_notifiers){
+        printf("[REMINDER] %s%s#%d due %s : %s\n",
+               list, sep, t->id, when, task_desc(t));
+        fflush(stdout);
+        metrics.notifications++;
+        return;
+    }
+    size_t L=strlen(list) + t->len + sizeof when + 16;
+    char *msg=(char*)malloc(L);
+    if(!msg){perror("malloc"); exit(1);}
+    if (cur_list->name)
+        snprintf(msg, L, "[%s] %s (due %s)", list, task_desc(t), when);
+    else
+        snprintf(msg, L, "%s (due %s)", task_desc(t), when);
+    for (int i=0;i<n_notifiers;i++) {
+        Notifier *nt=&notifiers[i];
+        if (nt->qhead + nt->qlen == nt->qcap) {
+            if (nt->qhead) {
+                memmove(nt->queue, nt->queue + nt->qhead, nt->qlen * sizeof *nt->queue);
+                nt->qhead=0;
+            } else {
+                nt->qcap = nt->qcap ? nt->qcap*2 : 16;
+                char **q=(char**)realloc(nt->queue, nt->qcap * sizeof *q);
+                if(!q){perror("realloc"); exit(1);}
+                nt->queue=q;
+            }
+        }
+        char *copy=strdup(msg);
+        if(!copy){perror("strdup"); exit(1);}
+        nt->queue[nt->qhead + nt->qlen++]=copy;
+    }
+    free(msg);
+}
+
+static void notify_spawn(Notifier *nt){
+    size_t take = notify_batch ? (nt->qlen < NOTIFY_BATCH_MAX ? nt->qlen : NOTIFY_BATCH_MAX) : 1;
+    char **args=(char**)malloc(((size_t)nt->argc + take + 1) * sizeof *args);
+    if(!args){perror("malloc"); exit(1);}
+    for (int k=0;k<nt->argc;k++) args[k]=nt->argv[k];
+    for (size_t k=0;k<take;k++) args[nt->argc+k]=nt->queue[nt->qhead+k];
+    args[(size_t)nt->argc+take]=NULL;
+    // Own process group, so a timeout also stops whatever it started.
+    posix_spawnattr_t attr;
+    posix_spawnattr_init(&attr);
+    posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETPGROUP);
+    posix_spawnattr_setpgroup(&attr, 0);
+    pid_t pid;
+    int rc=posix_spawnp(&pid, args[0], NULL, &attr, args, environ);
+    posix_spawnattr_destroy(&attr);
+    for (size_t k=0;k<take;k++) free(nt->queue[nt->qhead+k]);
+    nt->qhead+=take;
+    nt->qlen-=take;
+    if (!nt->qlen) nt->qhead=0;
+    free(args);
+    metrics.notifications+=take;
+    if (rc!=0) {
+        metrics.notify_failures++;
+        return;
+    }
+    NotifyRun *r=&nt->run[nt->nrun++];
+    r->pid=pid;
+    r->started=mono_seconds();
+    r->term_sent=false;
+}
+
+// Reaps finished notifiers, enforces timeouts and starts queued work.
+// Returns how many finished; *next is the seconds until a timeout check
+// is due, or -1.
+static int notify_pump(double *next){
+    *next=-1;
+    if (!n_notifiers) return 0;
+    char drain[64];
+    while (read(chld_pipe[0], drain, sizeof drain) > 0) { }
+    double now=mono_seconds();
+    int reaped=0;
+    for (int i=0;i<n_notifiers;i++) {
+        Notifier *nt=&notifiers[i];
+        for (int k=0;k<nt->nrun;) {
+            NotifyRun *r=&nt->run[k];
+            int status=0;
+            if (waitpid(r->pid,&status,WNOHANG)==r->pid) {
+                metric_observe(PH_NOTIFY, now - r->started);
+                if (!WIFEXITED(status) || WEXITSTATUS(status)!=0) metrics.notify_failures++;
+                nt->run[k]=nt->run[--nt->nrun];
+                reaped++;
+                continue;
+            }
+            double age=now - r->started;
+            if (!r->term_sent && age >= notify_timeout) {
+                kill(-r->pid, SIGTERM);
+                r->term_sent=true;
+                metrics.notify_timeouts++;
+            } else if (r->term_sent && age >= notify_timeout + NOTIFY_KILL_GRACE) {
+                kill(-r->pid, SIGKILL);
+            }
+            double due = (r->term_sent ? notify_timeout + NOTIFY_KILL_GRACE : notify_timeout) - age;
+            if (due < 0) due = 0;
+            if (*next < 0 || due < *next) *next=due;
+            k++;
+        }
+        int before=nt->nrun;
+        while (nt->qlen && nt->nrun < notify_limit) notify_spawn(nt);
+        if (nt->nrun > before && (*next < 0 || notify_timeout < *next)) *next=notify_timeout;
+    }
+    return reaped;
+}
+
+// Blocks until wall-clock time `when`, until the task files change, or
+// until a notifier exits. On Linux the deadline is a CLOCK_REALTIME
+// timerfd, so suspend and clock changes don't make reminders late;
+// elsewhere it is a poll timeout.
+static void wait_until(time_t when){
+    struct pollfd pf[3];
+    nfds_t n=0;
+    int timeout_ms=-1;
+#ifdef __linux__
+    static int tfd = -2;
+    if (tfd == -2) tfd = timerfd_create(CLOCK_REALTIME, TFD_CLOEXEC|TFD_NONBLOCK);
+    struct itimerspec its;
+    memset(&its,0,sizeof its);
+    its.it_value.tv_sec=when;
+    if (tfd >= 0 && timerfd_settime(tfd, TFD_TIMER_ABSTIME, &its, NULL)==0) {
+        pf[n].fd=tfd;
+        pf[n].events=POLLIN;
+        n++;
+    }
+#endif
+    if (n==0) {
+        time_t now=time(NULL);
+        if (when <= now) return;
+        timeout_ms = (when-now) > 86400 ? 86400*1000 : (int)(when-now)*1000;
+    }
+    if (change_fd >= 0) {
+        pf[n].fd=change_fd;
+        pf[n].events=POLLIN;
+        n++;
+    }
+    if (chld_pipe[0] >= 0) {
+        pf[n].fd=chld_pipe[0];
+        pf[n].events=POLLIN;
+        n++;
+    }
+    if (poll(pf,n,timeout_ms) <= 0) return;
+#ifdef __linux__
+    if (tfd >= 0 && (pf[0].revents & POLLIN)) {
+        uint64_t expirations;
+        if (read(tfd, &expirations, sizeof expirations) < 0) { }
+    }
+#endif
+}
+
+static void watch_stats_path(char *out, size_t L){
+    snprintf(out, L, "%s.watch-stats", active_file);
+}
+
+// The watcher has no socket, so it publishes its metrics to a file that
+// `stats` prints. Written only after something happened: the write itself
+// wakes the inotify watch on the store directory.
+static void watch_write_stats(time_t next_fire){
+    char path[540], tmp[550];
+    list_enter(&default_list);
+    watch_stats_path(path, sizeof path);
+    snprintf(tmp, sizeof tmp, "%s.tmp", path);
+    OutBuf out={0};
+    ob_printf(&out, "# clitask watch pid %d\n", (int)getpid());
+    write_metrics(&out);
+    ob_printf(&out, "# HELP clitask_watch_next_reminder_time_seconds "
+                    "Unix time the next reminder is due to fire, 0 = none.\n"
+                    "# TYPE clitask_watch_next_reminder_time_seconds gauge\n"
+                    "clitask_watch_next_reminder_time_seconds %lld\n", (long long)next_fire);
+    int fd=open(tmp, O_WRONLY|O_CREAT|O_TRUNC, 0644);
+    if (fd >= 0) {
+        bool ok=ob_flush_fd(&out, fd);
+        if (close(fd)==0 && ok) rename(tmp, path);
+        else unlink(tmp);
+    }
+    ob_free(&out);
+}
+
+// Notifies the current list's tasks and occurrences due in [now, now +
+// lead] that were not notified yet: a range scan of the ordered index.
+// Returns when the first later one enters that window, or 0 if none will.
+static time_t watch_scan_list(time_t now, int lead_min, bool *fired){
+    time_t lead=(time_t)lead_min*60;
+    time_t past=now + lead + 1;
+    DueIter it;
+    due_begin(&it, &tasks, now, 0, 0, past);
+    for (const Task *t; (t=due_next(&it)); ) {
+        uint64_t key=occ_key(t);
+        if (idset_has(&seen, key)) continue;
+        notify_task(t);
+        // The scan never looks behind now again, so before the set
+        // would grow, drop what it can no longer match.
+        if ((seen.len+1)*2 > seen.cap) idset_prune(&seen, now);
+        idset_add(&seen, key);
+        *fired=true;
+    }
+    due_end(&it);
+    OrdIter o;
+    tl_seek(&tasks, past, 0, &o);
+    const Task *t=tl_next(&tasks,&o);
+    time_t fire = t && t->due ? t->due - lead : 0;
+    for (size_t i=0;i<tasks.nrules;i++) {
+        time_t at=repeat_next(tl_find(&tasks,tasks.rules[i]), past) - lead;
+        if (!fire || at < fire) fire=at;
+    }
+    return fire;
+}
+
+static void detach_from_terminal(void){
+    if (setsid() < 0) { }
+    signal(SIGHUP, SIG_IGN);
+}
+
+static void cmd_watch(int argc, char **argv){
+    int interval = (argc>=1)? atoi(argv[0]) : 60;
+    if (interval <= 0) interval = 60;
+    int lead_min = (argc>=2)? atoi(argv[1]) : 10;
+    if (lead_min <= 0) lead_min = 10;
+    int notify_argc = (argc>=3)? (argc-2) : 0;
+    char **notify_argv = (argc>=3)? (&argv[2]) : NULL;
+    pid_t pid = fork();
+    if (pid < 0){ perror("fork"); return; }
+    if (pid > 0){
+        printf("Watcher started (pid=%d). Scanning every %ds; lead=%dmin.\n",
+               (int)pid, interval, lead_min);
+        return;
+    }
+    detach_from_terminal();
+    metrics.started = time(NULL);
+    notify_init(notify_argc, notify_argv);
+    change_watch_init();
+    // New named lists show up as directories appearing in the lists dir.
+    char probe[300];
+    snprintf(probe, sizeof probe, "%s/.", lists_dir);
+    uint32_t lists_seen = 0;
+    int lists_wd = watch_dir_of(probe, &lists_seen);
+    lists_scan();
+    time_t now = time(NULL);
+    bool dirty = true;
+    while (1){
+        // Without inotify, `interval` bounds how stale the lists can get.
+        time_t wake = now + interval, next_fire = 0;
+        for (size_t i=0; i<=n_lists; i++){
+            list_enter(list_at(i));
+            if (store_refresh()) dirty = true;
+            str_maybe_compact();
+            time_t fire = watch_scan_list(now, lead_min, &dirty);
+            if (fire && (!next_fire || fire < next_fire)) next_fire = fire;
+        }
+        if (next_fire && next_fire < wake) wake = next_fire;
+        double timeout_in;
+        if (notify_pump(&timeout_in) > 0) dirty = true;
+        if (dirty) watch_write_stats(next_fire);
+        dirty = false;
+        if (timeout_in >= 0 && now + (time_t)timeout_in + 1 < wake)
+            wake = now + (time_t)timeout_in + 1;
+        wait_until(wake);
+        now = time(NULL);
+        change_drain();
+        if (change_since(lists_wd, &lists_seen)) lists_scan();
+    }
+}
+
+// ---------- Resident daemon ----------
+
+// `daemon` keeps the lists in memory and runs add/delete/list/removed/
+// search for clients on a Unix socket (<active>.sock, CLITASK_SOCKET).
+// main() tries the socket before loading anything and falls back to the
+// files when no daemon answers; CLITASK_DAEMON=0 skips the attempt.
+//
+// Request: NUL-terminated strings "CLTASK2", then KEY=VALUE for the
+// client's environment and cwd=<dir>, an empty string, then argv. The
+// client closes its write side; the reply is the command's output, then
+// one byte with its exit status. Settings in daemon_env are applied for
+// the one request. Those in daemon_fixed_env were fixed when the daemon
+// loaded its store, so a client whose values or working directory differ
+// gets DAEMON_ELSEWHERE and runs the command itself.
+
+#define DAEMON_REQ_MAX (64*1024)
+#define DAEMON_ELSEWHERE 255
+
+static const char *const daemon_env[]={"USE_COLOR", "CLITASK_ALL_LIMIT",
+    "CLITASK_REMOVED_PAGE", "CLITASK_FSYNC", "CLITASK_JOURNAL_MAX",
+    "CLITASK_ARCHIVE_SEGMENT", "CLITASK_THREADS", "CLITASK_LOAD_STATS", NULL};
+
+static const char *const daemon_fixed_env[]={"CLITASK_STORE", "CLITASK_FILE",
+    "CLITASK_REMOVED", "CLITASK_JOURNAL", "CLITASK_INDEX", "CLITASK_LISTS",
+    "CLITASK_LIST", "CLITASK_INTERN", NULL};
+
+static int run_command(int argc, char **argv);
+
+static bool daemon_handles(const char *cmd){
+    static const char *const cmds[]={"add", "delete", "remove", "list",
+                                     "removed", "search", "daemon-stop", NULL};
+    for (int i=0; cmds[i]; i++)
+        if (strcmp(cmds[i],cmd)==0) return true;
+    return false;
+}
+
+static bool daemon_addr(struct sockaddr_un *sa){
+    char path[sizeof sa->sun_path + 1];
+    const char *env=getenv("CLITASK_SOCKET");
+    int n = env && *env ? snprintf(path, sizeof path, "%s", env)
+                        : snprintf(path, sizeof path, "%s.sock", active_file);
+    if (n < 0 || (size_t)n >= sizeof sa->sun_path) return false;
+    memset(sa,0,sizeof *sa);
+    sa->sun_family=AF_UNIX;
+    memcpy(sa->sun_path, path, (size_t)n + 1);
+    return true;
+}
+
+static int daemon_connect(void){
+    struct sockaddr_un sa;
+    if (!daemon_addr(&sa)) return -1;
+    int fd=socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd<0) return -1;
+    if (connect(fd, (struct sockaddr*)&sa, sizeof sa)!=0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+static void daemon_put_env(OutBuf *req, const char *const *names){
+    for (int i=0; names[i]; i++) {
+        const char *v=getenv(names[i]);
+        if (v) ob_printf(req, "%s=%s%c", names[i], v, '\0');
+    }
+}
+
+// Runs argv on a daemon if one is listening and returns its exit status;
+// -1 means "do it here".
+static int daemon_forward(int argc, char **argv){
+    const char *off=getenv("CLITASK_DAEMON");
+    if ((off && strcmp(off,"0")==0) || !daemon_handles(argv[0])) return -1;
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof cwd)) return -1;
+    int fd=daemon_connect();
+    if (fd<0) return -1;
+    OutBuf req={0};
+    ob_put(&req, "CLTASK2", 8);
+    daemon_put_env(&req, daemon_env);
+    daemon_put_env(&req, daemon_fixed_env);
+    ob_printf(&req, "cwd=%s%c", cwd, '\0');
+    ob_putc(&req, '\0');
+    for (int i=0;i<argc;i++) ob_put(&req, argv[i], strlen(argv[i]) + 1);
+    bool sent = req.len <= DAEMON_REQ_MAX && ob_flush_fd(&req, fd);
+    ob_free(&req);
+    if (!sent) { close(fd); return -1; }
+    shutdown(fd, SHUT_WR);
+    // The last byte is the status, so each read is passed on one late.
+    char buf[16384], held=0;
+    bool have=false;
+    for (;;) {
+        ssize_t r=read(fd, buf, sizeof buf);
+        if (r<0 && errno==EINTR) continue;
+        if (r<=0) break;
+        struct iovec iov[2]={{&held,have ? 1 : 0},{buf,(size_t)r-1}};
+        write_iov(STDOUT_FILENO, iov, 2);
+        held=buf[r-1];
+        have=true;
+    }
+    close(fd);
+    if (!have) {
+        fprintf(stderr, "The daemon closed the connection without answering.\n");
+        return 1;
+    }
+    unsigned char rc=(unsigned char)held;
+    return rc==DAEMON_ELSEWHERE ? -1 : rc;
+}
+
+// True when the client's value of every daemon_fixed_env setting, and its
+// working directory, are the daemon's own.
+static bool daemon_same_setup(char *const *kv, int n){
+    for (int i=0; daemon_fixed_env[i]; i++) {
+        const char *mine=getenv(daemon_fixed_env[i]), *theirs=NULL;
+        size_t k=strlen(daemon_fixed_env[i]);
+        for (int j=0;j<n;j++)
+            if (strncmp(kv[j],daemon_fixed_env[i],k)==0 && kv[j][k]=='=') theirs=kv[j]+k+1;
+        if (mine ? !theirs || strcmp(mine,theirs)!=0 : theirs!=NULL) return false;
+    }
+    char cwd[4096];
+    if (!getcwd(cwd, sizeof cwd)) return false;
+    for (int j=0;j<n;j++)
+        if (strncmp(kv[j],"cwd=",4)==0) return strcmp(kv[j]+4,cwd)==0;
+    return false;
+}
+
+// Reads one request and runs it with stdout/stderr pointed at the client.
+static void daemon_serve_one(int fd){
+    char *buf=(char*)malloc(DAEMON_REQ_MAX);
+    if(!buf){perror("malloc"); exit(1);}
+    size_t len=0;
+    struct pollfd p={fd, POLLIN, 0};
+    while (len < DAEMON_REQ_MAX && poll(&p,1,2000) > 0) {
+        ssize_t r=read(fd, buf+len, DAEMON_REQ_MAX-len);
+        if (r<0 && errno==EINTR) continue;
+        if (r<=0) break;
+        len+=(size_t)r;
+    }
+    char *argv[64], *kv[64];
+    int argc=0, nkv=0;
+    unsigned char rc=0;
+    bool ok = len >= 8 && memcmp(buf,"CLTASK2",8)==0 && buf[len-1]=='\0';
+    if (ok) {
+        char *s=buf+8, *end=buf+len;
+        for (; s<end && *s; s+=strlen(s)+1)
+            if (nkv < 64) kv[nkv++]=s;
+        for (s++; s<end && argc < 64; s+=strlen(s)+1) argv[argc++]=s;
+        ok = argc>=1 && daemon_handles(argv[0]);
+    }
+    if (ok && strcmp(argv[0],"daemon-stop")==0) {
+        const char msg[]="Daemon stopping.\n";
+        (void)!write(fd, msg, sizeof msg - 1);
+        srv_running=0;
+    } else if (ok && !daemon_same_setup(kv, nkv)) {
+        rc=DAEMON_ELSEWHERE;
+    } else if (ok) {
+        for (int i=0; daemon_env[i]; i++) unsetenv(daemon_env[i]);
+        for (int j=0;j<nkv;j++) {
+            char *eq=strchr(kv[j],'=');
+            if (!eq) continue;
+            *eq='\0';
+            for (int i=0; daemon_env[i]; i++)
+                if (strcmp(daemon_env[i],kv[j])==0) setenv(kv[j], eq+1, 1);
+        }
+        store_refresh();
+        str_maybe_compact();
+        fflush(stdout);
+        fflush(stderr);
+        int saved_out=dup(STDOUT_FILENO), saved_err=dup(STDERR_FILENO);
+        dup2(fd, STDOUT_FILENO);
+        dup2(fd, STDERR_FILENO);
+        rc=(unsigned char)run_command(argc, argv);
+        fflush(stdout);
+        fflush(stderr);
+        dup2(saved_out, STDOUT_FILENO);
+        dup2(saved_err, STDERR_FILENO);
+        close(saved_out);
+        close(saved_err);
+    } else {
+        const char msg[]="Bad request.\n";
+        (void)!write(fd, msg, sizeof msg - 1);
+        rc=2;
+    }
+    (void)!write(fd, &rc, 1);
+    free(buf);
+}
+
+// daemon [stop]
+static void cmd_daemon(int argc, char **argv){
+    if (argc>=1 && strcmp(argv[0],"stop")==0) {
+        char *stop[]={(char*)"daemon-stop"};
+        if (daemon_forward(1, stop) < 0) printf("No daemon is running.\n");
+        return;
+    }
+    struct sockaddr_un sa;
+    if (!daemon_addr(&sa)) {
+        printf("Socket path too long; set CLITASK_SOCKET.\n");
+        return;
+    }
+    int probe=daemon_connect();
+    if (probe>=0) {
+        close(probe);
+        printf("A daemon is already listening on %s.\n", sa.sun_path);
+        return;
+    }
+    unlink(sa.sun_path);
+    int s=socket(AF_UNIX, SOCK_STREAM, 0);
+    if (s<0) { perror("socket"); return; }
+    if (bind(s,(struct sockaddr*)&sa,sizeof sa)<0) { perror("bind"); close(s); return; }
+    if (listen(s, SOMAXCONN)<0) { perror("listen"); close(s); return; }
+    pid_t pid=fork();
+    if (pid<0) { perror("fork"); return; }
+    if (pid>0) {
+        close(s);
+        printf("Daemon started (pid=%d) on %s.\n", (int)pid, sa.sun_path);
+        return;
+    }
+    detach_from_terminal();
+    int null=open("/dev/null", O_RDWR);
+    if (null>=0) {
+        dup2(null, STDIN_FILENO);
+        dup2(null, STDOUT_FILENO);
+        dup2(null, STDERR_FILENO);
+        if (null > STDERR_FILENO) close(null);
+    }
+    struct sigaction act;
+    memset(&act,0,sizeof act);
+    act.sa_handler=handle_sigint;
+    sigaction(SIGTERM, &act, NULL);
+    sigaction(SIGINT, &act, NULL);
+    signal(SIGPIPE, SIG_IGN);
+    change_watch_init();
+    while (srv_running) {
+        struct pollfd p={s, POLLIN, 0};
+        if (poll(&p,1,1000) <= 0) continue;
+        int c=accept(s, NULL, NULL);
+        if (c<0) continue;
+        daemon_serve_one(c);
+        close(c);
+    }
+    close(s);
+    unlink(sa.sun_path);
+    exit(0);
+}
+
+// ---------- Benchmarks ----------
+
+// bench [--sizes 1000,100000] [--repeat N] [--warmup N]
+// Times each stage on synthetic lists and prints one JSON object per
+// (size, stage) on stdout, so runs from two builds can be diffed. Works in
+// a private temp directory and never writes the real store.
+
+typedef struct {
+    size_t   n;
+    char     dir[256];
+    char     text_path[300];
+    char     bin_path[300];
+    int     *victims;        // ids removed by the delete stage
+    size_t   nvictims;
+    uint64_t rng;
+} BenchCtx;
+
+typedef double (*bench_stage)(BenchCtx *cx);
+
+static uint64_t bench_rand(BenchCtx *cx){
+    cx->rng ^= cx->rng << 13;
+    cx->rng ^= cx->rng >> 7;
+    cx->rng ^= cx->rng << 17;
+    return cx->rng;
+}
+
+// Due dates: 15% undated, a third of the rest at 23:59 (date-only
+// entries), the others on the minute, from 30 days back to 90 ahead.
+// Descriptions: mostly 10-40 bytes, a quarter up to 120, a few near 250.
+static void bench_generate(BenchCtx *cx, TaskList *l){
+    static const char *words[]={"call","email","review","report","meeting",
+        "buy","milk","fix","bike","pay","bill","tax","doctor","garden",
+        "deploy","release","draft","plan","budget","team","weekly","notes"};
+    size_t nw=sizeof words / sizeof *words;
+    time_t today=local_midnight(time(NULL),0);
+    tl_free(l);
+    str_free(&strs);
+    tl_reserve(l,cx->n);
+    for (size_t i=0;i<cx->n;i++) {
+        Task *t=&l->recs[i];
+        memset(t,0,sizeof *t);
+        t->id=(int)i+1;
+        uint64_t r=bench_rand(cx);
+        if (r%100 >= 15) {
+            long day=(long)((r>>8)%120) - 30;
+            long mins = (r>>16)%3==0 ? 23*60+59 : (long)((r>>24)%(24*60));
+            t->due=today + day*86400 + mins*60;
+        }
+        uint64_t p=bench_rand(cx)%100;
+        size_t want = p<70 ? 10+p%31 : p<95 ? 40+(p*7)%81 : 120+(p*13)%131;
+        char desc[256];
+        size_t len=0;
+        while (len < want) {
+            const char *w = bench_rand(cx)%4 ? words[bench_rand(cx)%nw] : NULL;
+            char num[16];
+            if (!w) { snprintf(num,sizeof num,"w%u",(unsigned)(bench_rand(cx)%50000)); w=num; }
+            size_t k=strlen(w);
+            if (len + k + 1 >= sizeof desc) break;
+            if (len) desc[len++]=' ';
+            memcpy(desc+len,w,k);
+            len+=k;
+        }
+        t->len=(uint32_t)len;
+        t->desc=str_put(&strs,desc,len);
+    }
+    l->len=cx->n;
+    tl_index_tail(l,0);
+}
+
+static double bench_save_text(BenchCtx *cx){
+    double t0=mono_seconds();
+    save_file_text(cx->text_path,&tasks,false);
+    return mono_seconds()-t0;
+}
+
+static double bench_save_bin(BenchCtx *cx){
+    double t0=mono_seconds();
+    save_file_bin(cx->bin_path,&tasks,false);
+    return mono_seconds()-t0;
+}
+
+// Loads go into an empty arena of their own, as in a fresh process.
+static double bench_load_text(BenchCtx *cx){
+    TaskList l;
+    memset(&l,0,sizeof l);
+    StrArena keep=strs;
+    memset(&strs,0,sizeof strs);
+    int next=1;
+    double t0=mono_seconds();
+    load_file_text(cx->text_path,&l,&next);
+    double dt=mono_seconds()-t0;
+    tl_free(&l);
+    str_free(&strs);
+    strs=keep;
+    return dt;
+}
+
+static double bench_load_bin(BenchCtx *cx){
+    TaskList l;
+    memset(&l,0,sizeof l);
+    StrArena keep=strs;
+    memset(&strs,0,sizeof strs);
+    int next=1;
+    double t0=mono_seconds();
+    load_file_bin(cx->bin_path,&l,&next);
+    double dt=mono_seconds()-t0;
+    tl_free(&l);
+    str_free(&strs);
+    strs=keep;
+    return dt;
+}
+
+// Building the ordered index; dropped again so later stages pay for
+// their own, as a fresh process would.
+static double bench_sort(BenchCtx *cx){
+    (void)cx;
+    double t0=mono_seconds();
+    tl_order(&tasks);
+    double dt=mono_seconds()-t0;
+    ord_free(tasks.order);
+    tasks.order=NULL;
+    return dt;
+}
+
+// Rendering as serve does it, with the ordered index already resident.
+static double bench_render_text(BenchCtx *cx){
+    (void)cx;
+    OutBuf out={0};
+    tl_order(&tasks);
+    double t0=mono_seconds();
+    write_all_tasks_text(&out);
+    double dt=mono_seconds()-t0;
+    ob_free(&out);
+    return dt;
+}
+
+static double bench_render_json(BenchCtx *cx){
+    (void)cx;
+    OutBuf out={0};
+    tl_order(&tasks);
+    double t0=mono_seconds();
+    write_all_tasks_json(&out);
+    double dt=mono_seconds()-t0;
+    ob_free(&out);
+    return dt;
+}
+
+// Moves 1% of the tasks (at least one) to a removed list by id, on a copy.
+static double bench_delete(BenchCtx *cx){
+    TaskList l, r;
+    memset(&l,0,sizeof l);
+    memset(&r,0,sizeof r);
+    tl_reserve(&l,tasks.len);
+    memcpy(l.recs,tasks.recs,tasks.len * sizeof *l.recs);
+    l.len=tasks.len;
+    tl_index_tail(&l,0);
+    double t0=mono_seconds();
+    for (size_t i=0;i<cx->nvictims;i++) {
+        Task t;
+        if (tl_remove(&l,cx->victims[i],&t)) tl_push(&r,t);
+    }
+    double dt=mono_seconds()-t0;
+    tl_free(&l);
+    tl_free(&r);
+    return dt;
+}
+
+static double bench_index(BenchCtx *cx){
+    (void)cx;
+    size_t len=0;
+    double t0=mono_seconds();
+    char *img=search_build(&len);
+    double dt=mono_seconds()-t0;
+    free(img);
+    return dt;
+}
+
+static int cmp_double(const void *a, const void *b){
+    double x=*(const double*)a, y=*(const double*)b;
+    return (x>y)-(x<y);
+}
+
+static void cmd_bench(int argc, char **argv){
+    const char *sizes="1000,10000,100000,1000000";
+    int repeat=5, warmup=1;
+    for (int i=0;i<argc;i++) {
+        if (strcmp(argv[i],"--sizes")==0 && i+1<argc) sizes=argv[++i];
+        else if (strcmp(argv[i],"--repeat")==0 && i+1<argc) repeat=atoi(argv[++i]);
+        else if (strcmp(argv[i],"--warmup")==0 && i+1<argc) warmup=atoi(argv[++i]);
+        else {
+            printf("Usage: bench [--sizes N,N,...] [--repeat N] [--warmup N]\n");
+            return;
+        }
+    }
+    if (repeat < 1) repeat=1;
+    if (warmup < 0) warmup=0;
+
+    static const struct { const char *name; bench_stage fn; } stages[]={
+        {"save_text",   bench_save_text},
+        {"save_bin",    bench_save_bin},
+        {"load_text",   bench_load_text},
+        {"load_bin",    bench_load_bin},
+        {"sort",        bench_sort},
+        {"render_text", bench_render_text},
+        {"render_json", bench_render_json},
+        {"delete",      bench_delete},
+        {"index",       bench_index},
+    };
+    size_t nstages=sizeof stages / sizeof *stages;
+
+    BenchCtx cx;
+    memset(&cx,0,sizeof cx);
+    const char *tmp=getenv("TMPDIR");
+    snprintf(cx.dir,sizeof cx.dir,"%s/clitask-bench-XXXXXX",tmp && *tmp ? tmp : "/tmp");
+    if (!mkdtemp(cx.dir)) { perror("mkdtemp"); return; }
+    snprintf(cx.text_path,sizeof cx.text_path,"%s/tasks.txt",cx.dir);
+    snprintf(cx.bin_path,sizeof cx.bin_path,"%s/tasks.bin",cx.dir);
+
+    // Stages render the global lists; park the real ones meanwhile.
+    TaskList real_tasks=tasks, real_trash=trash;
+    StrArena real_strs=strs;
+    bool real_loaded=trash_loaded;
+    size_t real_segs=archive.n;
+    memset(&tasks,0,sizeof tasks);
+    memset(&trash,0,sizeof trash);
+    memset(&strs,0,sizeof strs);
+    trash_loaded=true;
+    archive.n=0;
+    double *runs=(double*)malloc((size_t)repeat * sizeof *runs);
+    if(!runs){perror("malloc"); exit(1);}
+
+    char list[256];
+    copy_bounded(list,sizeof list,sizes);
+    char *save=NULL;
+    for (char *tok=strtok_r(list,",",&save); tok; tok=strtok_r(NULL,",",&save)) {
+        cx.n=(size_t)strtoull(tok,NULL,10);
+        if (!cx.n) continue;
+        cx.rng=0x9e3779b97f4a7c15ull ^ cx.n;
+        bench_generate(&cx,&tasks);
+        cx.nvictims = cx.n/100 ? cx.n/100 : 1;
+        free(cx.victims);
+        cx.victims=(int*)malloc(cx.nvictims * sizeof *cx.victims);
+        if(!cx.victims){perror("malloc"); exit(1);}
+        for (size_t i=0;i<cx.nvictims;i++) cx.victims[i]=(int)(bench_rand(&cx)%cx.n)+1;
+
+        for (size_t s=0;s<nstages;s++) {
+            for (int w=0;w<warmup;w++) stages[s].fn(&cx);
+            double sum=0;
+            for (int r=0;r<repeat;r++) { runs[r]=stages[s].fn(&cx); sum+=runs[r]; }
+            qsort(runs,(size_t)repeat,sizeof *runs,cmp_double);
+            double median = repeat%2 ? runs[repeat/2] : (runs[repeat/2-1]+runs[repeat/2])/2;
+            size_t per = strcmp(stages[s].name,"delete")==0 ? cx.nvictims : cx.n;
+            printf("{\"size\":%zu,\"stage\":\"%s\",\"repeat\":%d,\"warmup\":%d,"
+                   "\"min_ms\":%.3f,\"median_ms\":%.3f,\"mean_ms\":%.3f,\"max_ms\":%.3f,"
+                   "\"ns_per_item\":%.1f}\n",
+                   cx.n, stages[s].name, repeat, warmup,
+                   runs[0]*1e3, median*1e3, sum/repeat*1e3, runs[repeat-1]*1e3,
+                   median*1e9/(double)per);
+            fflush(stdout);
+        }
+    }
+
+    free(runs);
+    free(cx.victims);
+    tl_free(&tasks);
+    tl_free(&trash);
+    str_free(&strs);
+    tasks=real_tasks;
+    trash=real_trash;
+    strs=real_strs;
+    trash_loaded=real_loaded;
+    archive.n=real_segs;
+    unlink(cx.text_path);
+    unlink(cx.bin_path);
+    rmdir(cx.dir);
+}
+
+// stats: the metrics last published by a running watcher.
+static void cmd_stats(int argc, char **argv){
+    (void)argc; (void)argv;
+    char path[540];
+    watch_stats_path(path, sizeof path);
+    size_t len=0;
+    char *data=read_whole(path, &len);
+    if (!data) {
+        printf("No watcher stats at %s (is `watch` running?).\n", path);
+        return;
+    }
+    fwrite(data, 1, len, stdout);
+    free(data);
+}
+
+typedef void (*handler_t)(int,char**);
+typedef struct { const char *name; handler_t fn; } Command;
+
+static void cmd_delete_alias(int argc, char **argv){
+    cmd_delete(argc, argv);
+}
+
+static Command CMDS[] = {
+    {"add", cmd_add},
     {"list", cmd_list},
     {"delete", cmd_delete},
     {"remove", cmd_delete_alias},
     {"removed", cmd_removed},
+    {"search", cmd_search},
     {"save", cmd_save},
+    {"import", cmd_import},
+    {"export", cmd_export},
     {"help", cmd_help},
     {"serve", cmd_serve},
     {"watch", cmd_watch},
+    {"stats", cmd_stats},
+    {"daemon", cmd_daemon},
+    {"bench", cmd_bench},
     {NULL, NULL}
 };
 
-static void load_all(void){
-    load_file(active_file,&head,&nextId);
-    load_file(removed_file,&trash_head,&nextId);
+static bool writes_store(const char *cmd){
+    return strcmp(cmd,"add")==0 || strcmp(cmd,"delete")==0 ||
+           strcmp(cmd,"remove")==0 || strcmp(cmd,"import")==0 ||
+           strcmp(cmd,"save")==0;
+}
+
+// Returns the exit status, or -1 for an unknown command.
+static int run_command(int argc, char **argv){
+    for (int i=0; CMDS[i].name; ++i){
+        if (strcmp(CMDS[i].name, argv[0])==0) {
+            bool w=writes_store(argv[0]);
+            if (w && !store_begin()) return 1;
+            CMDS[i].fn(argc-1, argv+1);
+            if (w) store_end();
+            return 0;
+        }
+    }
+    return -1;
 }
 
 static void at_exit_cleanup(void){
-    save_all_quiet();
-    list_free(&head);
-    list_free(&trash_head);
+    for (size_t i=0;i<n_lists;i++)
+        if (lists[i]->loaded) list_unload(lists[i]);
+    list_release();
 }
 
 int main(int argc, char **argv){
     atexit(at_exit_cleanup);
     init_paths();
-    load_all();
+    select_cli_list();
     if (argc<2){
         cmd_help(0,NULL);
         return 2;
     }
-    const char *cmd=argv[1];
-    for (int i=0; CMDS[i].name; ++i){
-        if (strcmp(CMDS[i].name, cmd)==0) {
-            CMDS[i].fn(argc-2, argv+2);
-            return 0;
-        }
+    int fwd=daemon_forward(argc-1, argv+1);
+    if (fwd >= 0) return fwd;
+    if (strcmp(argv[1],"help")!=0) {
+        stamp_all();
+        load_all();
     }
-    printf("Unknown command: %s\nTry: %s help\n", cmd, argv[0]);
+    int rc=run_command(argc-1, argv+1);
+    if (rc >= 0) return rc;
+    printf("Unknown command: %s\nTry: %s help\n", argv[1], argv[0]);
     return 2;
 }
 